@@ -0,0 +1,100 @@
+/**
+ * @file BlockRamp.h
+ * @author Joseph Larralde
+ * @date 17/10/2026
+ * @brief jl::Ramp wrapper telling when a processed block is constant
+ *
+ * @copyright
+ * Copyright (C) 2026 by Joseph Larralde.
+ * All rights reserved.
+ *
+ * License (BSD 3-clause)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _JL_BLOCK_RAMP_H_
+#define _JL_BLOCK_RAMP_H_
+
+#include "../dependencies/cpp-jl/src/dsp/utilities/Ramp.h"
+
+// Most of the time our ramps have reached their target, and filling and then
+// reading a buffer of identical values is just a waste of memory bandwidth.
+// BlockRamp keeps track of the ramp's progress so that process() can return
+// nullptr when the whole block is constant. The callers can then use the value
+// returned by getValue() as a scalar gain (or skip the block entirely).
+// getCurrent() gives the value reached so far, for callers that need to know
+// which way a new ramp goes while the previous one is still running.
+
+template <typename T, typename S>
+class BlockRamp {
+private:
+  jl::Ramp<T, S> r;
+  T start;
+  T target;
+  unsigned long length;
+  unsigned long remaining;
+  // true until the first block following a call to ramp() has been produced,
+  // so that jumps (0 sample ramps) are seen at least once by the callers
+  bool fresh;
+
+public:
+  BlockRamp() : start(0), target(0), length(0), remaining(0), fresh(false) {}
+
+  void ramp(T t, unsigned long samples = 0) {
+    r.ramp(t, samples);
+    start = getCurrent();
+    target = t;
+    length = samples;
+    remaining = samples;
+    fresh = true;
+  }
+
+  // returns the next n ramp values, or nullptr if they are all equal to
+  // getValue(), in which case the underlying buffer is left untouched
+  S* process(unsigned long n) {
+    if (remaining == 0 && !fresh) {
+      return nullptr;
+    }
+
+    fresh = false;
+    remaining = (remaining > n) ? remaining - n : 0;
+    return r.process(n);
+  }
+
+  bool isRamping() const { return remaining > 0 || fresh; }
+  S getValue() const { return static_cast<S>(target); }
+
+  // linear progress from the value the last ramp started at to its target
+  S getCurrent() const {
+    if (remaining == 0) {
+      return static_cast<S>(target);
+    }
+
+    return static_cast<S>(target - (target - start) * remaining / length);
+  }
+};
+
+#endif /* _JL_BLOCK_RAMP_H_ */
@@ -0,0 +1,442 @@
+/**
+ * @file DiskStream.h
+ * @author Joseph Larralde
+ * @date 17/10/2026
+ * @brief wav file player streaming from disk through a background thread
+ *
+ * @copyright
+ * Copyright (C) 2026 by Joseph Larralde.
+ * All rights reserved.
+ *
+ * License (BSD 3-clause)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _JL_DISK_STREAM_H_
+#define _JL_DISK_STREAM_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "WavReader.h"
+#include "Interpolation.h"
+
+// The first headDuration ms of the file are loaded when it is opened, so that
+// playback starts immediately, while a reader thread fills a lock-free ring
+// buffer with the rest of the file, starting right after the head. Each start
+// asks the reader to seek back to the end of the head, and the audio side only
+// uses ring data written after the reader acknowledged the request. Frames
+// that are not in the ring in time are played as silence and counted as
+// underruns, the playhead keeps going and the late frames are dropped when they
+// arrive. The audio side never blocks, allocates, or touches the file.
+
+//============================= SPSC RING ====================================//
+
+// single producer single consumer ring of samples, capacity being a power of 2
+class SpscRing {
+private:
+  std::vector<float> data;
+  std::size_t mask;
+  std::atomic<std::size_t> readIndex;
+  std::atomic<std::size_t> writeIndex;
+
+public:
+  SpscRing(std::size_t minCapacity = 1) : readIndex(0), writeIndex(0) {
+    resize(minCapacity);
+  }
+
+  // empties the ring, not to be called while it is in use
+  void resize(std::size_t minCapacity) {
+    std::size_t capacity = 1;
+
+    while (capacity < minCapacity) {
+      capacity <<= 1;
+    }
+
+    data.assign(capacity, 0.f);
+    mask = capacity - 1;
+    readIndex.store(0);
+    writeIndex.store(0);
+  }
+
+  std::size_t capacity() const { return data.size(); }
+
+  // producer side
+
+  std::size_t writable() const {
+    return data.size() - (writeIndex.load(std::memory_order_relaxed) -
+                          readIndex.load(std::memory_order_acquire));
+  }
+
+  std::size_t getWriteIndex() const {
+    return writeIndex.load(std::memory_order_relaxed);
+  }
+
+  void write(const float *in, std::size_t n) {
+    std::size_t w = writeIndex.load(std::memory_order_relaxed);
+
+    for (std::size_t i = 0; i < n; ++i) {
+      data[(w + i) & mask] = in[i];
+    }
+
+    writeIndex.store(w + n, std::memory_order_release);
+  }
+
+  // consumer side
+
+  std::size_t readable() const {
+    return writeIndex.load(std::memory_order_acquire) -
+           readIndex.load(std::memory_order_relaxed);
+  }
+
+  void read(float *out, std::size_t n) {
+    std::size_t r = readIndex.load(std::memory_order_relaxed);
+
+    for (std::size_t i = 0; i < n; ++i) {
+      out[i] = data[(r + i) & mask];
+    }
+
+    readIndex.store(r + n, std::memory_order_release);
+  }
+
+  void skip(std::size_t n) {
+    readIndex.store(readIndex.load(std::memory_order_relaxed) + n,
+                    std::memory_order_release);
+  }
+
+  // drop everything written before index
+  void skipTo(std::size_t index) {
+    readIndex.store(index, std::memory_order_release);
+  }
+};
+
+//============================= DISK STREAM ==================================//
+
+class DiskStream {
+private:
+  // frames of margin kept around the playhead for the widest kernel
+  static const long margin = 8;
+
+  float headDuration; // ms
+  float ringDuration; // ms
+
+  WavReader reader;
+  unsigned int channels;
+  long frames;
+  float fileSamplingRate;
+
+  std::vector<float> head;
+  long headFrames;
+
+  SpscRing ring;
+  std::thread thread;
+  std::atomic<bool> quit;
+  std::atomic<unsigned long> requested; // start requests from the audio side
+  std::atomic<unsigned long> acked;     // and the last one the reader handled
+  std::atomic<std::size_t> ackedWriteIndex; // ring position of that request
+
+  // audio side : window of consecutive frames around the playhead
+  std::vector<float> window;
+  long windowCapacity;
+  long windowStart;
+  long windowLength;
+  long nextRingFrame; // frame number of the next frame in the ring
+  bool synced;        // if the ring holds frames of the current request
+
+  std::vector<double> rates;
+  double position;
+  double maxRate;
+  bool playing;
+  bool stopping;
+  float gain;
+  float gainStep;
+
+  std::atomic<unsigned long> underruns;
+  std::atomic<int> ended; // -1, or 0 if stopped, 1 if the end was reached
+  int endOffset;          // sample of the block where playback ended
+
+  void readerLoop() {
+    const long chunkFrames = 4096;
+    std::vector<float> chunk(chunkFrames * channels);
+    long fileFrame = headFrames;
+    unsigned long handled = acked.load();
+
+    while (!quit.load(std::memory_order_acquire)) {
+      unsigned long request = requested.load(std::memory_order_acquire);
+
+      if (request != handled) {
+        reader.seek(headFrames);
+        fileFrame = headFrames;
+        handled = request;
+        ackedWriteIndex.store(ring.getWriteIndex(), std::memory_order_relaxed);
+        acked.store(request, std::memory_order_release);
+      }
+
+      long n = std::min(chunkFrames, frames - fileFrame);
+      n = std::min(n, static_cast<long>(ring.writable() / channels));
+
+      if (n > 0 && (n == chunkFrames || fileFrame + n == frames)) {
+        n = reader.read(chunk.data(), n);
+        ring.write(chunk.data(), n * channels);
+        fileFrame += n;
+
+        if (n == 0) {
+          // truncated file, nothing more to read
+          fileFrame = frames;
+        }
+      } else {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      }
+    }
+  }
+
+  // append count frames to the window, from the head, the ring or silence
+  void append(long count) {
+    while (count > 0) {
+      long f = windowStart + windowLength;
+      float *dst = window.data() + windowLength * channels;
+      long n;
+
+      if (f < headFrames) {
+        n = std::min(count, headFrames - f);
+        std::copy(head.begin() + f * channels, head.begin() + (f + n) * channels, dst);
+      } else if (f >= frames) {
+        n = count;
+        std::fill(dst, dst + n * channels, 0.f);
+      } else {
+        n = std::min(count, frames - f);
+        long got = 0;
+
+        if (!synced && acked.load(std::memory_order_acquire) ==
+                       requested.load(std::memory_order_relaxed)) {
+          ring.skipTo(ackedWriteIndex.load(std::memory_order_relaxed));
+          nextRingFrame = headFrames;
+          synced = true;
+        }
+
+        if (synced) {
+          long available = static_cast<long>(ring.readable() / channels);
+
+          if (nextRingFrame < f) {
+            // frames we already played as silence
+            long late = std::min(f - nextRingFrame, available);
+            ring.skip(late * channels);
+            nextRingFrame += late;
+            available -= late;
+          }
+
+          if (nextRingFrame == f) {
+            got = std::min(n, available);
+            ring.read(dst, got * channels);
+            nextRingFrame += got;
+          }
+        }
+
+        std::fill(dst + got * channels, dst + n * channels, 0.f);
+        underruns.fetch_add(n - got, std::memory_order_relaxed);
+      }
+
+      windowLength += n;
+      count -= n;
+    }
+  }
+
+  // make the window hold at least frames [lo, hi]
+  void fill(long lo, long hi) {
+    if (lo > windowStart) {
+      long drop = std::min(lo - windowStart, windowLength);
+      std::copy(window.begin() + drop * channels,
+                window.begin() + windowLength * channels,
+                window.begin());
+      windowStart += drop;
+      windowLength -= drop;
+
+      if (windowLength == 0) {
+        windowStart = lo;
+      }
+    }
+
+    long missing = std::min(hi + 1 - (windowStart + windowLength),
+                            windowCapacity - windowLength);
+
+    if (missing > 0) {
+      append(missing);
+    }
+  }
+
+public:
+  DiskStream(float headMs = 500, float ringMs = 2000) :
+  headDuration(headMs), ringDuration(ringMs), channels(0), frames(0), fileSamplingRate(0), headFrames(0),
+  ring(1), quit(false), requested(0), acked(0), ackedWriteIndex(0),
+  windowCapacity(0), windowStart(0), windowLength(0), nextRingFrame(0),
+  synced(false), position(0), maxRate(4), playing(false), stopping(false),
+  gain(0), gainStep(0), underruns(0), ended(-1), endOffset(0) {}
+
+  ~DiskStream() {
+    quit.store(true, std::memory_order_release);
+
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+
+  DiskStream(const DiskStream&) = delete;
+  DiskStream& operator=(const DiskStream&) = delete;
+
+  // load the head and start the reader thread, false if the file can't be read
+  bool open(const char *path) {
+    if (!reader.open(path)) {
+      return false;
+    }
+
+    channels = reader.getChannels();
+    frames = reader.getFrames();
+    fileSamplingRate = reader.getSamplingRate();
+
+    headFrames = std::min(frames, static_cast<long>(headDuration * 0.001 * fileSamplingRate));
+    head.resize(headFrames * channels);
+    headFrames = reader.read(head.data(), headFrames);
+
+    ring.resize(static_cast<std::size_t>(ringDuration * 0.001 * fileSamplingRate) * channels);
+
+    thread = std::thread(&DiskStream::readerLoop, this);
+    return true;
+  }
+
+  unsigned int getChannels() const { return channels; }
+  float getSamplingRate() const { return fileSamplingRate; }
+  long getFrames() const { return frames; }
+  bool isPlaying() const { return playing; }
+
+  // size the audio side buffers for blocks of blockSize samples played at up
+  // to rate times the file's speed (not to be called while processing)
+  void prepare(int blockSize, double rate) {
+    maxRate = rate;
+    rates.resize(blockSize);
+    windowCapacity = static_cast<long>(std::ceil(blockSize * maxRate)) + 2 * margin + 2;
+    window.resize(windowCapacity * channels);
+    windowStart = 0;
+    windowLength = 0;
+  }
+
+  // fade durations in samples
+  void start(float fadeIn) {
+    requested.fetch_add(1, std::memory_order_release);
+    synced = false;
+    position = 0;
+    windowStart = 0;
+    windowLength = 0;
+    playing = true;
+    stopping = false;
+    gain = 0;
+    gainStep = 1.f / std::max(fadeIn, 1.f);
+  }
+
+  void stop(float fadeOut) {
+    if (playing) {
+      stopping = true;
+      gainStep = -1.f / std::max(fadeOut, 1.f);
+    }
+  }
+
+  unsigned long takeUnderruns() {
+    return underruns.exchange(0, std::memory_order_relaxed);
+  }
+
+  // -1 if playback didn't end since the last call, otherwise 0 if it was
+  // stopped, 1 if it reached the end of the file
+  int takeEnded() {
+    return ended.exchange(-1, std::memory_order_relaxed);
+  }
+
+  // index in the last processed block of the sample where playback ended
+  int getEndOffset() const { return endOffset; }
+
+  // play n samples into nbOuts outputs (file channels beyond the last are
+  // taken from the last one), baseRate being the speed in file frames per
+  // output sample before applying the detune signal (in semitones). If given,
+  // positions receives the playhead position normalized to the file length
+  template <class Kernel>
+  void process(const float *detune, float **outs, unsigned int nbOuts, int n,
+               double baseRate, float *positions = nullptr) {
+    if (!playing) {
+      for (unsigned int c = 0; c < nbOuts; ++c) {
+        std::fill(outs[c], outs[c] + n, 0.f);
+      }
+
+      if (positions != nullptr) {
+        std::fill(positions, positions + n, frames > 0 ? position / frames : 0.f);
+      }
+
+      return;
+    }
+
+    // read all the detune values first as outs may share their vector
+    double end = position;
+
+    for (int i = 0; i < n; ++i) {
+      rates[i] = std::min(std::max(baseRate * std::exp2(detune[i] / 12.), 0.), maxRate);
+      end += rates[i];
+    }
+
+    fill(static_cast<long>(position) - margin, static_cast<long>(end) + margin + 1);
+
+    JlInterpSource src = {
+      reinterpret_cast<const char *>(window.data()), windowLength, channels, sizeof(float)
+    };
+
+    for (int i = 0; i < n; ++i) {
+      long k = static_cast<long>(position);
+      float frac = static_cast<float>(position - k);
+
+      for (unsigned int c = 0; c < nbOuts; ++c) {
+        outs[c][i] = playing
+                   ? gain * Kernel::read(src, k - windowStart, frac,
+                                         std::min(c, channels - 1))
+                   : 0.f;
+      }
+
+      if (positions != nullptr) {
+        positions[i] = static_cast<float>(std::min(position / frames, 1.));
+      }
+
+      gain = std::min(gain + gainStep, 1.f);
+      position += rates[i];
+
+      if (playing && (gain <= 0 || position >= frames)) {
+        ended.store(gain <= 0 ? 0 : 1, std::memory_order_relaxed);
+        endOffset = i;
+        playing = false;
+      }
+    }
+  }
+};
+
+#endif /* _JL_DISK_STREAM_H_ */
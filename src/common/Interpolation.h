@@ -0,0 +1,201 @@
+/**
+ * @file Interpolation.h
+ * @author Joseph Larralde
+ * @date 17/10/2026
+ * @brief table interpolation kernels, selected at compile time
+ *
+ * @copyright
+ * Copyright (C) 2026 by Joseph Larralde.
+ * All rights reserved.
+ *
+ * License (BSD 3-clause)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _JL_INTERPOLATION_H_
+#define _JL_INTERPOLATION_H_
+
+#include <cmath>
+#include <vector>
+
+// Each kernel is a struct with a static read(source, index, frac, channel)
+// function returning the value of a channel between frames index and
+// index + 1. Loops over samples take the kernel as a template parameter, so the
+// choice is made once per loop rather than once per sample.
+
+// interleaved float frames, stride being the distance in bytes between two
+// consecutive samples (sizeof(t_word) to read a garray in place)
+struct JlInterpSource {
+  const char *base;
+  long frames;
+  unsigned int channels;
+  unsigned int stride;
+
+  // silence outside of the buffer
+  float get(long frame, unsigned int channel) const {
+    if (frame < 0 || frame >= frames) {
+      return 0;
+    }
+
+    return *reinterpret_cast<const float *>(
+      base + (frame * channels + channel) * stride
+    );
+  }
+};
+
+//================================ KERNELS ===================================//
+
+struct JlInterpNearest {
+  static float read(const JlInterpSource& s, long i, float frac, unsigned int c) {
+    return s.get(frac < 0.5f ? i : i + 1, c);
+  }
+};
+
+struct JlInterpLinear {
+  static float read(const JlInterpSource& s, long i, float frac, unsigned int c) {
+    float a = s.get(i, c);
+    return a + frac * (s.get(i + 1, c) - a);
+  }
+};
+
+// 4 points, 3rd order (catmull-rom)
+struct JlInterpHermite {
+  static float read(const JlInterpSource& s, long i, float frac, unsigned int c) {
+    float xm1 = s.get(i - 1, c);
+    float x0 = s.get(i, c);
+    float x1 = s.get(i + 1, c);
+    float x2 = s.get(i + 2, c);
+
+    float c1 = 0.5f * (x1 - xm1);
+    float c2 = xm1 - 2.5f * x0 + 2.f * x1 - 0.5f * x2;
+    float c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+
+    return ((c3 * frac + c2) * frac + c1) * frac + x0;
+  }
+};
+
+// blackman windowed sinc over 2 * ZeroCrossings points, the weights being
+// tabulated for Phases + 1 fractional positions
+template <int ZeroCrossings = 8, int Phases = 256>
+struct JlInterpSinc {
+  static const float *weights() {
+    static const std::vector<float> table = [] {
+      const double pi = 3.14159265358979323846;
+      std::vector<float> t((Phases + 1) * 2 * ZeroCrossings);
+
+      for (int p = 0; p <= Phases; ++p) {
+        double frac = static_cast<double>(p) / Phases;
+
+        for (int k = 0; k < 2 * ZeroCrossings; ++k) {
+          double d = frac - (k - ZeroCrossings + 1);
+          double sinc = (d == 0) ? 1 : std::sin(pi * d) / (pi * d);
+          double window = 0.42 + 0.5 * std::cos(pi * d / ZeroCrossings)
+                        + 0.08 * std::cos(2 * pi * d / ZeroCrossings);
+          t[p * 2 * ZeroCrossings + k] = static_cast<float>(sinc * window);
+        }
+      }
+
+      return t;
+    }();
+
+    return table.data();
+  }
+
+  static float read(const JlInterpSource& s, long i, float frac, unsigned int c) {
+    const float *w = weights()
+                   + static_cast<int>(frac * Phases + 0.5f) * 2 * ZeroCrossings;
+    float sum = 0;
+
+    for (int k = 0; k < 2 * ZeroCrossings; ++k) {
+      sum += w[k] * s.get(i - ZeroCrossings + 1 + k, c);
+    }
+
+    return sum;
+  }
+};
+
+// blackman windowed sinc lowpass over Taps points (odd), cutting at a bit less
+// than half the nyquist frequency, used to halve a buffer's rate
+template <int Taps = 63>
+struct JlInterpHalfBand {
+  static const float *weights() {
+    static const std::vector<float> table = [] {
+      const double pi = 3.14159265358979323846;
+      const double cutoff = 0.23; // in cycles per sample, 0.25 being the new nyquist
+      const int m = Taps / 2;
+      std::vector<float> t(Taps);
+      double sum = 0;
+
+      for (int k = 0; k < Taps; ++k) {
+        double d = k - m;
+        double sinc = (d == 0) ? 2 * cutoff : std::sin(2 * pi * cutoff * d) / (pi * d);
+        double window = 0.42 + 0.5 * std::cos(pi * d / (m + 1))
+                      + 0.08 * std::cos(2 * pi * d / (m + 1));
+        t[k] = static_cast<float>(sinc * window);
+        sum += t[k];
+      }
+
+      // unity gain at dc
+      for (auto& w : t) {
+        w = static_cast<float>(w / sum);
+      }
+
+      return t;
+    }();
+
+    return table.data();
+  }
+
+  // filtered value of frame i
+  static float read(const JlInterpSource& s, long i, unsigned int c) {
+    const float *w = weights();
+    float sum = 0;
+
+    for (int k = 0; k < Taps; ++k) {
+      sum += w[k] * s.get(i - Taps / 2 + k, c);
+    }
+
+    return sum;
+  }
+};
+
+//================================ LOOPS =====================================//
+
+// write frames from to to (excluded) of src lowpassed and decimated by 2 into
+// out, as interleaved frames (src.frames / 2 of them in total), so that it can
+// be done in chunks
+template <class Filter = JlInterpHalfBand<>>
+void jl_interp_halve(const JlInterpSource& src, float *out, long from, long to) {
+  out += from * src.channels;
+
+  for (long f = from; f < to; ++f) {
+    for (unsigned int c = 0; c < src.channels; ++c) {
+      *out++ = Filter::read(src, 2 * f, c);
+    }
+  }
+}
+
+#endif /* _JL_INTERPOLATION_H_ */
@@ -0,0 +1,150 @@
+/**
+ * @file Mipmap.h
+ * @author Joseph Larralde
+ * @date 17/10/2026
+ * @brief octave decimated, band limited copies of a buffer, built in the
+ * background
+ *
+ * @copyright
+ * Copyright (C) 2026 by Joseph Larralde.
+ * All rights reserved.
+ *
+ * License (BSD 3-clause)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _JL_MIPMAP_H_
+#define _JL_MIPMAP_H_
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "Interpolation.h"
+
+// Level 0 is the buffer given to build(), and level L holds the same sound at
+// half the rate of level L - 1, lowpassed before decimation, so that reading
+// it 2^L times slower than level 0 gives the same pitch without aliasing.
+// The levels are computed one after the other by a background thread, and
+// become available as soon as they are done (see getReadyLevels). Only the
+// thread owning the Mipmap may call build, cancel and the getters.
+
+class Mipmap {
+public:
+  struct Level {
+    std::shared_ptr<std::vector<float>> data; // interleaved
+    long frames;
+    float samplingRate;
+  };
+
+private:
+  static const long chunkFrames = 16384; // between cancellation checks
+  static const long minFrames = 64;      // no smaller level
+
+  std::vector<Level> levels;
+  unsigned int channels;
+  std::atomic<unsigned int> ready;
+  std::atomic<bool> cancelled;
+  std::thread thread;
+
+  void builderLoop() {
+    for (unsigned int l = 1; l < levels.size(); ++l) {
+      const Level& prev = levels[l - 1];
+      JlInterpSource src = {
+        reinterpret_cast<const char *>(prev.data->data()),
+        prev.frames, channels, sizeof(float)
+      };
+
+      Level level;
+      level.frames = prev.frames / 2;
+      level.samplingRate = prev.samplingRate / 2;
+      level.data = std::make_shared<std::vector<float>>(level.frames * channels);
+
+      for (long f = 0; f < level.frames; f += chunkFrames) {
+        if (cancelled.load(std::memory_order_relaxed)) {
+          return;
+        }
+
+        jl_interp_halve(src, level.data->data(), f, std::min(f + chunkFrames, level.frames));
+      }
+
+      levels[l] = level;
+      ready.store(l + 1, std::memory_order_release);
+    }
+  }
+
+public:
+  Mipmap() : channels(1), ready(0), cancelled(false) {}
+
+  ~Mipmap() { cancel(); }
+
+  Mipmap(const Mipmap&) = delete;
+  Mipmap& operator=(const Mipmap&) = delete;
+
+  // stop building the current levels, if any, and forget them
+  void cancel() {
+    cancelled.store(true, std::memory_order_relaxed);
+
+    if (thread.joinable()) {
+      thread.join();
+    }
+
+    cancelled.store(false, std::memory_order_relaxed);
+    ready.store(0, std::memory_order_relaxed);
+    levels.clear();
+  }
+
+  // start building up to maxLevels levels above base (interleaved frames)
+  void build(std::shared_ptr<std::vector<float>> base, long frames,
+             unsigned int nbChannels, float samplingRate, unsigned int maxLevels) {
+    cancel();
+    channels = nbChannels;
+
+    unsigned int nbLevels = 1;
+
+    while (nbLevels <= maxLevels && (frames >> nbLevels) >= minFrames) {
+      nbLevels++;
+    }
+
+    levels.resize(nbLevels);
+    levels[0] = { base, frames, samplingRate };
+    ready.store(1, std::memory_order_release);
+
+    if (nbLevels > 1) {
+      thread = std::thread(&Mipmap::builderLoop, this);
+    }
+  }
+
+  // number of levels that can be read, level 0 included
+  unsigned int getReadyLevels() const {
+    return ready.load(std::memory_order_acquire);
+  }
+
+  const Level& getLevel(unsigned int l) const { return levels[l]; }
+};
+
+#endif /* _JL_MIPMAP_H_ */
@@ -0,0 +1,181 @@
+/**
+ * @file MixKernels.h
+ * @author Joseph Larralde
+ * @date 17/10/2026
+ * @brief vectorized multiply-accumulate kernels with runtime cpu dispatch
+ *
+ * @copyright
+ * Copyright (C) 2026 by Joseph Larralde.
+ * All rights reserved.
+ *
+ * License (BSD 3-clause)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _JL_MIX_KERNELS_H_
+#define _JL_MIX_KERNELS_H_
+
+#include "m_pd.h"
+
+// The x86 kernels only make sense for single precision samples, double
+// precision builds of pd (PD_FLOATSIZE == 64) always use the scalar ones.
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__)) && \
+    (!defined(PD_FLOATSIZE) || PD_FLOATSIZE == 32)
+#define JL_MIX_X86 1
+#include <immintrin.h>
+#endif
+
+// out[n] += in[n]
+typedef void (*t_mix_add)(t_sample* out, const t_sample* in, int n);
+// out[n] += in[n] * gain
+typedef void (*t_mix_gain)(t_sample* out, const t_sample* in, t_sample gain, int n);
+// out[n] += in[n] * ramp[n]
+typedef void (*t_mix_ramp)(t_sample* out, const t_sample* in, const t_sample* ramp, int n);
+
+typedef struct _mix_kernels {
+  const char* name;
+  t_mix_add add;
+  t_mix_gain gain;
+  t_mix_ramp ramp;
+} t_mix_kernels;
+
+//================================ SCALAR ====================================//
+
+static void jl_mix_add_scalar(t_sample* out, const t_sample* in, int n) {
+  for (int i = 0; i < n; ++i) { out[i] += in[i]; }
+}
+
+static void jl_mix_gain_scalar(t_sample* out, const t_sample* in, t_sample gain, int n) {
+  for (int i = 0; i < n; ++i) { out[i] += in[i] * gain; }
+}
+
+static void jl_mix_ramp_scalar(t_sample* out, const t_sample* in, const t_sample* ramp, int n) {
+  for (int i = 0; i < n; ++i) { out[i] += in[i] * ramp[i]; }
+}
+
+#ifdef JL_MIX_X86
+
+// All kernels use unaligned loads and stores as we don't control the alignment
+// of pd's signal vectors, and avoid fma so that they give the exact same
+// results as the scalar ones.
+
+//================================= SSE2 =====================================//
+
+__attribute__((target("sse2")))
+static void jl_mix_add_sse2(t_sample* out, const t_sample* in, int n) {
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 o = _mm_loadu_ps(out + i);
+    _mm_storeu_ps(out + i, _mm_add_ps(o, _mm_loadu_ps(in + i)));
+  }
+  for (; i < n; ++i) { out[i] += in[i]; }
+}
+
+__attribute__((target("sse2")))
+static void jl_mix_gain_sse2(t_sample* out, const t_sample* in, t_sample gain, int n) {
+  __m128 g = _mm_set1_ps(gain);
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 o = _mm_loadu_ps(out + i);
+    __m128 p = _mm_mul_ps(_mm_loadu_ps(in + i), g);
+    _mm_storeu_ps(out + i, _mm_add_ps(o, p));
+  }
+  for (; i < n; ++i) { out[i] += in[i] * gain; }
+}
+
+__attribute__((target("sse2")))
+static void jl_mix_ramp_sse2(t_sample* out, const t_sample* in, const t_sample* ramp, int n) {
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 o = _mm_loadu_ps(out + i);
+    __m128 p = _mm_mul_ps(_mm_loadu_ps(in + i), _mm_loadu_ps(ramp + i));
+    _mm_storeu_ps(out + i, _mm_add_ps(o, p));
+  }
+  for (; i < n; ++i) { out[i] += in[i] * ramp[i]; }
+}
+
+//================================= AVX2 =====================================//
+
+__attribute__((target("avx2")))
+static void jl_mix_add_avx2(t_sample* out, const t_sample* in, int n) {
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 o = _mm256_loadu_ps(out + i);
+    _mm256_storeu_ps(out + i, _mm256_add_ps(o, _mm256_loadu_ps(in + i)));
+  }
+  for (; i < n; ++i) { out[i] += in[i]; }
+}
+
+__attribute__((target("avx2")))
+static void jl_mix_gain_avx2(t_sample* out, const t_sample* in, t_sample gain, int n) {
+  __m256 g = _mm256_set1_ps(gain);
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 o = _mm256_loadu_ps(out + i);
+    __m256 p = _mm256_mul_ps(_mm256_loadu_ps(in + i), g);
+    _mm256_storeu_ps(out + i, _mm256_add_ps(o, p));
+  }
+  for (; i < n; ++i) { out[i] += in[i] * gain; }
+}
+
+__attribute__((target("avx2")))
+static void jl_mix_ramp_avx2(t_sample* out, const t_sample* in, const t_sample* ramp, int n) {
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 o = _mm256_loadu_ps(out + i);
+    __m256 p = _mm256_mul_ps(_mm256_loadu_ps(in + i), _mm256_loadu_ps(ramp + i));
+    _mm256_storeu_ps(out + i, _mm256_add_ps(o, p));
+  }
+  for (; i < n; ++i) { out[i] += in[i] * ramp[i]; }
+}
+
+#endif /* JL_MIX_X86 */
+
+//=============================== DISPATCH ===================================//
+
+static const t_mix_kernels jl_mix_kernels_scalar = {
+  "scalar", jl_mix_add_scalar, jl_mix_gain_scalar, jl_mix_ramp_scalar
+};
+
+// to be called once at load time (typically from the class setup function)
+static t_mix_kernels jl_mix_kernels_select() {
+#ifdef JL_MIX_X86
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx2")) {
+    return { "avx2", jl_mix_add_avx2, jl_mix_gain_avx2, jl_mix_ramp_avx2 };
+  }
+
+  if (__builtin_cpu_supports("sse2")) {
+    return { "sse2", jl_mix_add_sse2, jl_mix_gain_sse2, jl_mix_ramp_sse2 };
+  }
+#endif
+
+  return jl_mix_kernels_scalar;
+}
+
+#endif /* _JL_MIX_KERNELS_H_ */
@@ -0,0 +1,209 @@
+/**
+ * @file RoutingShared.h
+ * @author Joseph Larralde
+ * @date 17/10/2026
+ * @brief connection state shared by a routerctrl and any number of router~
+ *
+ * @copyright
+ * Copyright (C) 2026 by Joseph Larralde.
+ * All rights reserved.
+ *
+ * License (BSD 3-clause)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _JL_ROUTING_SHARED_H_
+#define _JL_ROUTING_SHARED_H_
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include "m_pd.h"
+
+// A routerctrl created with "-name foo" publishes its validated connections into
+// a small pd object bound to the private symbol __jl_routing_foo (so that foo
+// stays free for sends and receives), and a router~ created with "-ctrl foo"
+// reads them from there once per block. Messages and dsp run in the same pd
+// thread, so nothing here needs to be atomic.
+//
+// Each changed cell is appended to a change log and bumps the version, so a
+// reader only applies the cells logged since the version it last saw. The log
+// is emptied once it gets as long as the matrix, and a reader that was left
+// behind (or that sees the matrix change size) rescans all the cells instead,
+// which then costs no more than replaying the log would have.
+//
+// routerctrl and router~ are separate binaries, each one has its own copy of
+// this class, which is why an existing instance is recognized by its class name
+// rather than by its class pointer. Whoever comes first creates the instance,
+// and the last one to release it frees it.
+
+#define JL_ROUTING_SHARED_CLASS "jl-routing-shared"
+#define JL_ROUTING_SHARED_PREFIX "__jl_routing_"
+
+typedef struct _jl_routing_shared {
+  t_pd pd; // only there to be bound to a symbol
+  t_symbol* name; // the mangled one
+  unsigned int refcount;
+  bool has_writer;
+
+  unsigned long version; // always log_base + changes->size()
+  unsigned long log_base; // version at which the log was last emptied
+  unsigned int rows;
+  unsigned int columns;
+  std::vector<char>* cells; // index = row + column * rows
+  std::vector<unsigned int>* changes; // cell indices, in order of change
+} t_jl_routing_shared;
+
+static inline t_class* jl_routing_shared_class() {
+  static t_class* c = nullptr;
+
+  if (c == nullptr) {
+    c = class_new(gensym(JL_ROUTING_SHARED_CLASS), 0, 0,
+                  sizeof(t_jl_routing_shared), CLASS_PD, A_NULL);
+  }
+
+  return c;
+}
+
+// get the instance for name, creating it if needed
+static inline t_jl_routing_shared* jl_routing_shared_acquire(t_symbol* name) {
+  std::string mangled = std::string(JL_ROUTING_SHARED_PREFIX) + name->s_name;
+  t_symbol* bindName = gensym(mangled.c_str());
+  t_pd* thing = bindName->s_thing;
+
+  if (thing != nullptr &&
+      std::strcmp(class_getname(*thing), JL_ROUTING_SHARED_CLASS) == 0) {
+    auto* shared = (t_jl_routing_shared*) thing;
+    shared->refcount++;
+    return shared;
+  }
+
+  if (thing != nullptr) {
+    // someone else bound something to our private name
+    return nullptr;
+  }
+
+  auto* shared = (t_jl_routing_shared*) pd_new(jl_routing_shared_class());
+  shared->name = bindName;
+  shared->refcount = 1;
+  shared->has_writer = false;
+  shared->version = 0;
+  shared->log_base = 0;
+  shared->rows = 0;
+  shared->columns = 0;
+  shared->cells = new std::vector<char>();
+  shared->changes = new std::vector<unsigned int>();
+  pd_bind(&shared->pd, bindName);
+
+  return shared;
+}
+
+static inline void jl_routing_shared_release(t_jl_routing_shared* shared) {
+  if (shared == nullptr || --shared->refcount > 0) {
+    return;
+  }
+
+  pd_unbind(&shared->pd, shared->name);
+  delete shared->cells;
+  delete shared->changes;
+  pd_free(&shared->pd);
+}
+
+// empty the log, readers that didn't catch up will rescan the whole matrix
+static inline void jl_routing_shared_reset_log(t_jl_routing_shared* shared) {
+  shared->changes->clear();
+  shared->log_base = shared->version;
+}
+
+// called by the writer each time one of its cells changes
+static inline void jl_routing_shared_publish_cell(t_jl_routing_shared* shared,
+                                                  unsigned int index, bool value) {
+  char v = value ? 1 : 0;
+
+  if (index >= shared->cells->size() || (*shared->cells)[index] == v) {
+    return;
+  }
+
+  (*shared->cells)[index] = v;
+
+  if (shared->changes->size() >= shared->cells->size()) {
+    jl_routing_shared_reset_log(shared);
+  }
+
+  shared->changes->push_back(index);
+  shared->version++;
+}
+
+// called by the writer when its connections have been replaced as a whole,
+// only the cells that actually differ are logged
+static inline void jl_routing_shared_publish(t_jl_routing_shared* shared,
+                                             unsigned int rows, unsigned int columns,
+                                             const std::vector<bool>& connections) {
+  if (rows != shared->rows || columns != shared->columns) {
+    shared->rows = rows;
+    shared->columns = columns;
+    shared->cells->assign(connections.size(), 0);
+
+    for (unsigned int i = 0; i < connections.size(); ++i) {
+      (*shared->cells)[i] = connections[i] ? 1 : 0;
+    }
+
+    shared->version++;
+    jl_routing_shared_reset_log(shared);
+    return;
+  }
+
+  for (unsigned int i = 0; i < connections.size(); ++i) {
+    jl_routing_shared_publish_cell(shared, i, connections[i]);
+  }
+}
+
+// true if a reader that last saw version must rescan all the cells rather
+// than only the logged ones
+static inline bool jl_routing_shared_needs_rescan(const t_jl_routing_shared* shared,
+                                                  unsigned long version) {
+  return version < shared->log_base;
+}
+
+// the cells changed since version, to be read after needs_rescan returned false
+static inline const unsigned int*
+jl_routing_shared_changes_since(const t_jl_routing_shared* shared,
+                                unsigned long version, unsigned int* count) {
+  *count = static_cast<unsigned int>(shared->version - version);
+  return shared->changes->data() + (version - shared->log_base);
+}
+
+// 0 if out of the writer's bounds
+static inline char jl_routing_shared_get(const t_jl_routing_shared* shared,
+                                         unsigned int row, unsigned int column) {
+  if (row >= shared->rows || column >= shared->columns) {
+    return 0;
+  }
+
+  return (*shared->cells)[row + column * shared->rows];
+}
+
+#endif /* _JL_ROUTING_SHARED_H_ */
@@ -0,0 +1,124 @@
+/**
+ * @file SamplePool.h
+ * @author Joseph Larralde
+ * @date 17/10/2026
+ * @brief process-wide cache of decoded sound files, shared by reference
+ *
+ * @copyright
+ * Copyright (C) 2026 by Joseph Larralde.
+ * All rights reserved.
+ *
+ * License (BSD 3-clause)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _JL_SAMPLE_POOL_H_
+#define _JL_SAMPLE_POOL_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "WavReader.h"
+
+// Each file is decoded once into packed interleaved float frames, and stays
+// in memory as long as someone holds a reference to it : the pool itself only
+// keeps weak references, keyed by path. Not thread safe, only use it from the
+// main (message) thread. The pool is a function-local static, so it is shared
+// by all the instances of the external including this header.
+
+class SamplePool {
+public:
+  struct Sample {
+    std::string path;
+    std::vector<float> data; // interleaved
+    unsigned int channels;
+    float samplingRate;
+    long frames;
+  };
+
+private:
+  static std::map<std::string, std::weak_ptr<Sample>>& entries() {
+    static std::map<std::string, std::weak_ptr<Sample>> pool;
+    return pool;
+  }
+
+  static std::shared_ptr<Sample> load(const std::string& path) {
+    WavReader reader;
+
+    if (!reader.open(path.c_str())) {
+      return nullptr;
+    }
+
+    auto sample = std::make_shared<Sample>();
+    sample->path = path;
+    sample->channels = reader.getChannels();
+    sample->samplingRate = reader.getSamplingRate();
+    sample->data.resize(reader.getFrames() * reader.getChannels());
+    sample->frames = reader.read(sample->data.data(), reader.getFrames());
+    sample->data.resize(sample->frames * sample->channels);
+    return sample;
+  }
+
+public:
+  // returns the shared copy of the file, decoding it if nobody holds it yet,
+  // or nullptr if it can't be read
+  static std::shared_ptr<Sample> get(const std::string& path) {
+    auto& pool = entries();
+
+    // forget the files nobody uses anymore
+    for (auto it = pool.begin(); it != pool.end();) {
+      it = it->second.expired() ? pool.erase(it) : std::next(it);
+    }
+
+    auto it = pool.find(path);
+
+    if (it != pool.end()) {
+      return it->second.lock();
+    }
+
+    auto sample = load(path);
+
+    if (sample != nullptr) {
+      pool[path] = sample;
+    }
+
+    return sample;
+  }
+
+  // number of files currently held
+  static std::size_t size() {
+    std::size_t n = 0;
+
+    for (auto& entry : entries()) {
+      n += entry.second.expired() ? 0 : 1;
+    }
+
+    return n;
+  }
+};
+
+#endif /* _JL_SAMPLE_POOL_H_ */
@@ -0,0 +1,322 @@
+/**
+ * @file SamplerVoice.h
+ * @author Joseph Larralde
+ * @date 17/10/2026
+ * @brief buffer player with fades, selection, loop and reverse, whose read
+ * loop is instantiated for each interpolation kernel
+ *
+ * @copyright
+ * Copyright (C) 2026 by Joseph Larralde.
+ * All rights reserved.
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _JL_SAMPLER_VOICE_H_
+#define _JL_SAMPLER_VOICE_H_
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "Interpolation.h"
+
+// Plays the selection [begin, end] of a buffer forward or backward, at the
+// buffer's own speed transposed by a pitch (semitones) and a detune signal. A
+// note fades in on start, fades out when stopped, and fades out so as to reach
+// silence exactly at the selection bounds, from where it stops or loops with a
+// new fade in. Starting again while playing first fades out with the interrupt
+// duration. A buffer given while playing is only used from the next start,
+// whereas setSource switches the one being played to another copy of the same
+// content (e.g. a mipmap level), crossfading with it for a few samples.
+//
+// The read loop is a template on the interpolation kernel (see
+// Interpolation.h), chosen once per block by the caller. Events are reported
+// through the virtual callbacks, from inside process() : 0 when stopped, 1 when
+// the end of the selection was reached, 2 when looping. getEventOffset() then
+// tells at which sample of the block being processed it happened.
+
+class SamplerVoice {
+private:
+  enum State { Idle, Playing, Stopping, Interrupting };
+
+  unsigned int channels;
+  float samplingRate; // of the output
+
+  // given with setBuffer, used from the next start
+  JlInterpSource next;
+  float nextRate;
+  bool pending;
+
+  // the buffer being played, read from source
+  JlInterpSource source;
+  float contentRate;
+
+  // the copy left by setSource, read at position * fadingScale
+  static const int crossfadeLength = 64;
+  JlInterpSource fading;
+  double fadingScale;
+  int fadingLeft;
+  bool sounding; // since the last start
+
+  double position; // in frames
+  State state;
+  float gain;      // fade in / stop / interrupt envelope
+  float gainStep;
+
+  float pitch;     // semitones
+  float fadeIn;    // ms
+  float fadeOut;   // ms
+  float interrupt; // ms
+  float begin;     // ms
+  float end;       // ms, 0 for the end of the buffer
+  bool loop;
+  bool rvs;
+
+  std::vector<double> rates;
+  int eventOffset;
+
+  float samples(float ms) const {
+    return std::max(ms * 0.001f * samplingRate, 1.f);
+  }
+
+  // the selection in frames, the whole buffer if it is empty
+  void bounds(double& lo, double& hi) const {
+    double frames = static_cast<double>(source.frames);
+    lo = std::min(std::max(begin * 0.001 * contentRate, 0.), frames);
+    hi = std::min(std::max(end * 0.001 * contentRate, 0.), frames);
+
+    if (hi <= lo) {
+      hi = frames;
+    }
+  }
+
+  void restart() {
+    if (pending) {
+      source = next;
+      contentRate = nextRate;
+      pending = false;
+      bufUpdatedCallback();
+    }
+
+    if (source.frames == 0) {
+      state = Idle;
+      return;
+    }
+
+    double lo, hi;
+    bounds(lo, hi);
+    position = rvs ? hi : lo;
+    fadingLeft = 0;
+    sounding = false;
+    state = Playing;
+    gain = 0;
+    gainStep = 1.f / samples(fadeIn);
+  }
+
+public:
+  SamplerVoice(unsigned int c = 1) :
+  channels(c), samplingRate(44100), next({ nullptr, 0, c, sizeof(float) }),
+  nextRate(44100), pending(false), source({ nullptr, 0, c, sizeof(float) }),
+  contentRate(44100), fading({ nullptr, 0, c, sizeof(float) }),
+  fadingScale(1), fadingLeft(0), sounding(false), position(0), state(Idle),
+  gain(0), gainStep(0), pitch(0), fadeIn(5), fadeOut(5), interrupt(5), begin(0), end(0),
+  loop(false), rvs(false), eventOffset(0) {}
+
+  virtual ~SamplerVoice() {}
+
+  // interleaved frames with as many channels as the voice, at sr
+  void setBuffer(const JlInterpSource& src, float sr) {
+    next = src;
+    nextRate = sr;
+    pending = true;
+
+    if (state == Idle) {
+      // nothing to fade, the position is kept until the next start
+      source = next;
+      contentRate = nextRate;
+      pending = false;
+      bufUpdatedCallback();
+    }
+  }
+
+  // the same content as the buffer being played, at another rate. Nothing is
+  // pending or fading if the voice did not sound since its start
+  void setSource(const JlInterpSource& src, float sr) {
+    if (state != Idle && sounding) {
+      fading = source;
+      fadingScale = contentRate / sr;
+      fadingLeft = crossfadeLength;
+    }
+
+    position *= sr / contentRate;
+    source = src;
+    contentRate = sr;
+  }
+
+  // not to be called while processing
+  void prepare(int blockSize) { rates.resize(blockSize); }
+
+  void setSamplingRate(float sr) { samplingRate = sr; }
+  void setPitch(float p) { pitch = p; }
+  void setFades(float ms) { fadeIn = fadeOut = ms; }
+  void setFadeIn(float ms) { fadeIn = ms; }
+  void setFadeOut(float ms) { fadeOut = ms; }
+  void setInterrupt(float ms) { interrupt = ms; }
+  void setBegin(float ms) { begin = ms; }
+  void setEnd(float ms) { end = ms; }
+  void setLoop(bool l) { loop = l; }
+  void setRvs(bool r) { rvs = r; }
+
+  float getPitch() const { return pitch; }
+  bool isPlaying() const { return state != Idle; }
+
+  // playhead position normalized to the buffer's length
+  float getNormalizedPosition() const {
+    return source.frames > 0 ? static_cast<float>(position / source.frames) : 0.f;
+  }
+
+  void start() {
+    if (state == Idle) {
+      restart();
+    } else {
+      state = Interrupting;
+      gainStep = -1.f / samples(interrupt);
+    }
+  }
+
+  void stop() {
+    if (state != Idle) {
+      state = Stopping;
+      gainStep = -1.f / samples(fadeOut);
+    }
+  }
+
+  void getPosition() { getPositionCallback(getNormalizedPosition()); }
+
+  // sample of the block being processed where the last event happened
+  int getEventOffset() const { return eventOffset; }
+
+  // detune (semitones) may share its vector with one of the outs. If given,
+  // positions receives the normalized playhead position of each sample
+  template <class Kernel>
+  void process(const float *detune, float **outs, int n, float *positions = nullptr) {
+    if (state == Idle) {
+      for (unsigned int c = 0; c < channels; ++c) {
+        std::fill(outs[c], outs[c] + n, 0.f);
+      }
+
+      if (positions != nullptr) {
+        std::fill(positions, positions + n, getNormalizedPosition());
+      }
+
+      return;
+    }
+
+    // rates in frames of the output, times scale for frames of the source
+    double pitchRate = std::exp2(pitch / 12.);
+
+    for (int i = 0; i < n; ++i) {
+      rates[i] = std::max(pitchRate * std::exp2(detune[i] / 12.), 0.);
+    }
+
+    double scale = contentRate / samplingRate;
+
+    double lo, hi;
+    bounds(lo, hi);
+    float edgeSamples = samples(fadeOut);
+
+    for (int i = 0; i < n; ++i) {
+      if (positions != nullptr) {
+        positions[i] = getNormalizedPosition();
+      }
+
+      if (state == Idle) {
+        for (unsigned int c = 0; c < channels; ++c) {
+          outs[c][i] = 0.f;
+        }
+
+        continue;
+      }
+
+      // fade out towards the bound we are heading to
+      double rate = rates[i] * scale;
+      double distance = rvs ? position - lo : hi - position;
+      double edge = rate > 0 ? std::min(distance / (rate * edgeSamples), 1.) : 1.;
+      gain = std::min(std::max(gain + gainStep, 0.f), 1.f);
+      float g = gain * static_cast<float>(std::max(edge, 0.));
+
+      long k = static_cast<long>(std::floor(position));
+      float frac = static_cast<float>(position - k);
+
+      if (fadingLeft > 0) {
+        float a = static_cast<float>(fadingLeft--) / crossfadeLength;
+        double fadingPosition = position * fadingScale;
+        long fk = static_cast<long>(std::floor(fadingPosition));
+        float ffrac = static_cast<float>(fadingPosition - fk);
+
+        for (unsigned int c = 0; c < channels; ++c) {
+          outs[c][i] = g * ((1 - a) * Kernel::read(source, k, frac, c) +
+                            a * Kernel::read(fading, fk, ffrac, c));
+        }
+      } else {
+        for (unsigned int c = 0; c < channels; ++c) {
+          outs[c][i] = g * Kernel::read(source, k, frac, c);
+        }
+      }
+
+      sounding = true;
+      position += rvs ? -rate : rate;
+
+      if (state == Stopping && gain <= 0) {
+        state = Idle;
+        eventOffset = i;
+        endReachCallback(0);
+      } else if (state == Interrupting && gain <= 0) {
+        restart();
+        bounds(lo, hi);
+        scale = contentRate / samplingRate;
+      } else if (rvs ? position <= lo : position >= hi) {
+        if (loop && hi - lo >= 1) {
+          position += rvs ? hi - lo : lo - hi;
+          gain = 0;
+          gainStep = 1.f / samples(fadeIn);
+          eventOffset = i;
+          endReachCallback(2);
+        } else {
+          state = Idle;
+          eventOffset = i;
+          endReachCallback(1);
+        }
+      }
+    }
+  }
+
+  virtual void endReachCallback(int endReachType) {}
+  virtual void getPositionCallback(float position) {}
+  virtual void bufUpdatedCallback() {}
+};
+
+#endif /* _JL_SAMPLER_VOICE_H_ */
@@ -0,0 +1,90 @@
+/**
+ * @file ScratchArena.h
+ * @author Joseph Larralde
+ * @date 17/10/2026
+ * @brief grow-only aligned scratch memory for the perform routines
+ *
+ * @copyright
+ * Copyright (C) 2026 by Joseph Larralde.
+ * All rights reserved.
+ *
+ * License (BSD 3-clause)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _JL_SCRATCH_ARENA_H_
+#define _JL_SCRATCH_ARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// Aligned block of samples meant to be sized once when the object is created,
+// then only reallocated if a dsp graph rebuild really asks for more. This
+// avoids churning the heap each time dsp is toggled or a subpatch is opened.
+
+template <typename T, std::size_t Alignment = 64>
+class ScratchArena {
+private:
+  T* raw;
+  T* base;
+  std::size_t capacity; // in elements, from base
+
+public:
+  ScratchArena(std::size_t n = 0) : raw(nullptr), base(nullptr), capacity(0) {
+    reserve(n);
+  }
+
+  ~ScratchArena() { delete[] raw; }
+
+  ScratchArena(const ScratchArena&) = delete;
+  ScratchArena& operator=(const ScratchArena&) = delete;
+
+  // makes sure at least n elements are available, returns true if the memory
+  // had to be reallocated (the previous content is lost in this case)
+  bool reserve(std::size_t n) {
+    if (n <= capacity && raw != nullptr) {
+      return false;
+    }
+
+    const std::size_t pad = Alignment / sizeof(T);
+
+    delete[] raw;
+    raw = new T[n + pad]();
+
+    std::uintptr_t address = reinterpret_cast<std::uintptr_t>(raw);
+    std::uintptr_t aligned = (address + Alignment - 1) / Alignment * Alignment;
+    base = reinterpret_cast<T*>(aligned);
+    capacity = n + pad - (base - raw);
+
+    return true;
+  }
+
+  T* data() { return base; }
+  std::size_t size() const { return capacity; }
+  std::size_t bytes() const { return raw != nullptr ? (capacity + (base - raw)) * sizeof(T) : 0; }
+};
+
+#endif /* _JL_SCRATCH_ARENA_H_ */
@@ -0,0 +1,99 @@
+/**
+ * @file TriggerQueue.h
+ * @author Joseph Larralde
+ * @date 17/10/2026
+ * @brief pending triggers, run at the exact sample of a dsp block
+ *
+ * @copyright
+ * Copyright (C) 2026 by Joseph Larralde.
+ * All rights reserved.
+ *
+ * License (BSD 3-clause)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _JL_TRIGGER_QUEUE_H_
+#define _JL_TRIGGER_QUEUE_H_
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Times are in ms from any reference, e.g. the logical time the owner was
+// created at, as given by clock_gettimesince(). A block of n samples is split
+// into segments at the pending triggers that fall into it, like vline~ does
+// with its ramps, so that a processor started by a trigger starts at its
+// sample instead of at the next block boundary. Triggers whose time already
+// passed fire at the start of the next block. Messages and dsp run in the
+// same thread, so nothing here is thread safe.
+
+class TriggerQueue {
+private:
+  std::vector<double> times; // sorted
+
+public:
+  void add(double time) {
+    times.insert(std::upper_bound(times.begin(), times.end(), time), time);
+  }
+
+  void clear() { times.clear(); }
+
+  bool empty() const { return times.empty(); }
+
+  // sample i of the block is at blockStart + i * msPerSample. Calls
+  // process(offset, length) for each segment of the block and trigger()
+  // between them
+  template <typename Process, typename Trigger>
+  void run(double blockStart, double msPerSample, int n,
+           Process process, Trigger trigger) {
+    int offset = 0;
+
+    while (!times.empty()) {
+      // first sample at or after the trigger, forgiving rounding errors
+      double at = std::ceil((times.front() - blockStart) / msPerSample - 1e-6);
+
+      if (at >= n) {
+        break;
+      }
+
+      int next = std::max(static_cast<int>(at), offset);
+
+      if (next > offset) {
+        process(offset, next - offset);
+        offset = next;
+      }
+
+      times.erase(times.begin());
+      trigger();
+    }
+
+    if (offset < n) {
+      process(offset, n - offset);
+    }
+  }
+};
+
+#endif /* _JL_TRIGGER_QUEUE_H_ */
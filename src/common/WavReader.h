@@ -0,0 +1,208 @@
+/**
+ * @file WavReader.h
+ * @author Joseph Larralde
+ * @date 17/10/2026
+ * @brief minimal wav file reader, decoding to interleaved floats
+ *
+ * @copyright
+ * Copyright (C) 2026 by Joseph Larralde.
+ * All rights reserved.
+ *
+ * License (BSD 3-clause)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _JL_WAV_READER_H_
+#define _JL_WAV_READER_H_
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+
+// Reads uncompressed RIFF / WAVE files : 8, 16, 24 and 32 bits integer PCM and
+// 32 or 64 bits float, plain or WAVE_FORMAT_EXTENSIBLE. Samples are decoded
+// to interleaved floats in [-1, 1], frames at a time, so that files bigger
+// than memory can be streamed.
+
+class WavReader {
+private:
+  FILE *file;
+  unsigned int channels;
+  unsigned int bytesPerSample;
+  bool isFloat;
+  float samplingRate;
+  long frames;
+  long dataOffset;
+  std::vector<unsigned char> bytes;
+
+  static std::uint32_t le32(const unsigned char *b) {
+    return b[0] | (b[1] << 8) | (b[2] << 16) | (static_cast<std::uint32_t>(b[3]) << 24);
+  }
+
+  static std::uint16_t le16(const unsigned char *b) {
+    return b[0] | (b[1] << 8);
+  }
+
+  float decode(const unsigned char *b) const {
+    if (isFloat) {
+      if (bytesPerSample == 4) {
+        std::uint32_t u = le32(b);
+        float f;
+        std::memcpy(&f, &u, 4);
+        return f;
+      }
+
+      std::uint64_t u = le32(b) | (static_cast<std::uint64_t>(le32(b + 4)) << 32);
+      double d;
+      std::memcpy(&d, &u, 8);
+      return static_cast<float>(d);
+    }
+
+    switch (bytesPerSample) {
+      case 1:
+        return (b[0] - 128) / 128.f;
+      case 2:
+        return static_cast<std::int16_t>(le16(b)) / 32768.f;
+      case 3:
+        return static_cast<std::int32_t>(
+          (b[0] << 8) | (b[1] << 16) | (static_cast<std::uint32_t>(b[2]) << 24)
+        ) / 2147483648.f;
+      default:
+        return static_cast<std::int32_t>(le32(b)) / 2147483648.f;
+    }
+  }
+
+public:
+  WavReader() :
+  file(nullptr), channels(0), bytesPerSample(0), isFloat(false),
+  samplingRate(0), frames(0), dataOffset(0) {}
+
+  ~WavReader() { close(); }
+
+  WavReader(const WavReader&) = delete;
+  WavReader& operator=(const WavReader&) = delete;
+
+  unsigned int getChannels() const { return channels; }
+  float getSamplingRate() const { return samplingRate; }
+  long getFrames() const { return frames; }
+
+  // false if the file can't be read or is not a supported wav file
+  bool open(const char *path) {
+    close();
+    file = std::fopen(path, "rb");
+
+    if (file == nullptr) {
+      return false;
+    }
+
+    unsigned char header[12];
+
+    if (std::fread(header, 1, 12, file) != 12 ||
+        std::memcmp(header, "RIFF", 4) != 0 ||
+        std::memcmp(header + 8, "WAVE", 4) != 0) {
+      close();
+      return false;
+    }
+
+    bool hasFormat = false;
+    unsigned char chunk[8];
+
+    while (std::fread(chunk, 1, 8, file) == 8) {
+      std::uint32_t size = le32(chunk + 4);
+
+      if (std::memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+        std::vector<unsigned char> fmt(size);
+
+        if (std::fread(fmt.data(), 1, size, file) != size) {
+          break;
+        }
+
+        unsigned int format = le16(fmt.data());
+
+        if (format == 0xfffe && size >= 26) {
+          // WAVE_FORMAT_EXTENSIBLE, the format is in the sub format guid
+          format = le16(fmt.data() + 24);
+        }
+
+        channels = le16(fmt.data() + 2);
+        samplingRate = static_cast<float>(le32(fmt.data() + 4));
+        bytesPerSample = le16(fmt.data() + 14) / 8;
+        isFloat = (format == 3);
+        hasFormat = (format == 1 && bytesPerSample >= 1 && bytesPerSample <= 4) ||
+                    (format == 3 && (bytesPerSample == 4 || bytesPerSample == 8));
+
+        if (size & 1) {
+          std::fseek(file, 1, SEEK_CUR);
+        }
+      } else if (std::memcmp(chunk, "data", 4) == 0) {
+        if (!hasFormat || channels == 0) {
+          break;
+        }
+
+        dataOffset = std::ftell(file);
+        frames = size / (channels * bytesPerSample);
+        return true;
+      } else {
+        std::fseek(file, size + (size & 1), SEEK_CUR);
+      }
+    }
+
+    close();
+    return false;
+  }
+
+  void close() {
+    if (file != nullptr) {
+      std::fclose(file);
+      file = nullptr;
+    }
+  }
+
+  bool seek(long frame) {
+    return file != nullptr &&
+           std::fseek(file, dataOffset + frame * channels * bytesPerSample, SEEK_SET) == 0;
+  }
+
+  // decode up to n frames into out, returns the number of frames read
+  long read(float *out, long n) {
+    if (file == nullptr) {
+      return 0;
+    }
+
+    std::size_t frameBytes = channels * bytesPerSample;
+    bytes.resize(n * frameBytes);
+    long got = std::fread(bytes.data(), frameBytes, n, file);
+
+    for (long i = 0; i < got * channels; ++i) {
+      out[i] = decode(bytes.data() + i * bytesPerSample);
+    }
+
+    return got;
+  }
+};
+
+#endif /* _JL_WAV_READER_H_ */
@@ -0,0 +1,229 @@
+/**
+ * @file WorkerPool.h
+ * @author Joseph Larralde
+ * @date 17/10/2026
+ * @brief persistent worker threads woken once per dsp block
+ *
+ * @copyright
+ * Copyright (C) 2026 by Joseph Larralde.
+ * All rights reserved.
+ *
+ * License (BSD 3-clause)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _JL_WORKER_POOL_H_
+#define _JL_WORKER_POOL_H_
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <dispatch/dispatch.h>
+#else
+#include <semaphore.h>
+#endif
+
+// The pool owns nbThreads - 1 threads, the calling (audio) thread always
+// handles the first part of the job itself. Each worker waits on its own
+// semaphore, posted once per job, and the last one to finish posts the
+// caller's. These semaphores keep their count in an atomic and only go through
+// the system one when a thread actually has to sleep or be woken, so there is
+// no lock anywhere : run() is a few atomic operations, plus a system call to
+// wake the workers that went to sleep (or to sleep itself when they are late),
+// and never allocates.
+
+class WorkerPool {
+public:
+  typedef void (*task)(void* context, unsigned int part, unsigned int nbParts);
+
+private:
+  // counting semaphore spinning on an atomic count before it blocks, only
+  // negative when threads are blocked in the system semaphore
+  class Semaphore {
+  private:
+    std::atomic<int> count;
+#if defined(_WIN32)
+    HANDLE sem;
+#elif defined(__APPLE__)
+    dispatch_semaphore_t sem;
+#else
+    sem_t sem;
+#endif
+
+    bool tryWait() {
+      int c = count.load();
+
+      while (c > 0) {
+        if (count.compare_exchange_weak(c, c - 1)) {
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+  public:
+    Semaphore() : count(0) {
+#if defined(_WIN32)
+      sem = CreateSemaphore(nullptr, 0, MAXLONG, nullptr);
+#elif defined(__APPLE__)
+      sem = dispatch_semaphore_create(0);
+#else
+      sem_init(&sem, 0, 0);
+#endif
+    }
+
+    ~Semaphore() {
+#if defined(_WIN32)
+      CloseHandle(sem);
+#elif defined(__APPLE__)
+      dispatch_release(sem);
+#else
+      sem_destroy(&sem);
+#endif
+    }
+
+    // spins up to spins times (yielding each time if asked) before blocking
+    void wait(unsigned int spins, bool yield) {
+      for (unsigned int i = 0; i < spins; ++i) {
+        if (tryWait()) {
+          return;
+        }
+
+        if (yield) {
+          std::this_thread::yield();
+        }
+      }
+
+      if (count.fetch_sub(1) > 0) {
+        return;
+      }
+
+#if defined(_WIN32)
+      WaitForSingleObject(sem, INFINITE);
+#elif defined(__APPLE__)
+      dispatch_semaphore_wait(sem, DISPATCH_TIME_FOREVER);
+#else
+      while (sem_wait(&sem) != 0) {} // retry when interrupted by a signal
+#endif
+    }
+
+    void post() {
+      if (count.fetch_add(1) >= 0) {
+        return;
+      }
+
+#if defined(_WIN32)
+      ReleaseSemaphore(sem, 1, nullptr);
+#elif defined(__APPLE__)
+      dispatch_semaphore_signal(sem);
+#else
+      sem_post(&sem);
+#endif
+    }
+  };
+
+  // workers yield while spinning, they can wait for a whole block
+  static const unsigned int workerSpins = 4096;
+  // the caller only waits for the end of the other parts
+  static const unsigned int callerSpins = 16384;
+
+  std::vector<std::thread> workers;
+  std::unique_ptr<Semaphore[]> wakeWorkers;
+  Semaphore wakeCaller;
+  std::atomic<unsigned int> pending;
+  std::atomic<bool> quit;
+
+  task job;
+  void* context;
+  unsigned int nbParts;
+
+  void work(unsigned int part) {
+    while (true) {
+      wakeWorkers[part].wait(workerSpins, true);
+
+      if (quit.load()) {
+        return;
+      }
+
+      job(context, part, nbParts);
+
+      if (pending.fetch_sub(1) == 1) {
+        wakeCaller.post();
+      }
+    }
+  }
+
+public:
+  WorkerPool(unsigned int nbThreads) :
+  pending(0), quit(false), job(nullptr), context(nullptr),
+  nbParts(nbThreads > 0 ? nbThreads : 1) {
+    wakeWorkers.reset(new Semaphore[nbParts]);
+
+    for (unsigned int i = 1; i < nbParts; ++i) {
+      workers.emplace_back(&WorkerPool::work, this, i);
+    }
+  }
+
+  ~WorkerPool() {
+    quit.store(true);
+
+    for (unsigned int i = 1; i < nbParts; ++i) {
+      wakeWorkers[i].post();
+    }
+
+    for (auto& w : workers) {
+      w.join();
+    }
+  }
+
+  unsigned int getNbParts() const { return nbParts; }
+
+  // calls t(c, part, nbParts) for every part in parallel and returns when
+  // they are all done
+  void run(task t, void* c) {
+    job = t;
+    context = c;
+    pending.store(nbParts - 1);
+
+    for (unsigned int i = 1; i < nbParts; ++i) {
+      wakeWorkers[i].post();
+    }
+
+    job(context, 0, nbParts);
+
+    if (nbParts > 1) {
+      // the other parts should be about to finish too
+      wakeCaller.wait(callerSpins, false);
+    }
+  }
+};
+
+#endif /* _JL_WORKER_POOL_H_ */
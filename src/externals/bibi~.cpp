@@ -37,6 +37,7 @@
 
 #include "m_pd.h"
 #include "../dependencies/cpp-jl/src/core/filters/Biquad.h"
+#include "../common/BlockRamp.h"
 
 class PdBiquad;
 
@@ -69,8 +70,8 @@ private:
 
   jl::Biquad b;
 
-  jl::Ramp<float, jl::sample> rF;
-  jl::Ramp<float, jl::sample> rQ;
+  BlockRamp<float, jl::sample> rF;
+  BlockRamp<float, jl::sample> rQ;
 
   float samplingRate;
   float rampDuration;
@@ -93,6 +94,9 @@ public:
   void setSamplingRate(float sr) {
     samplingRate = sr;
     b.setSamplingRate(samplingRate);
+    // coefficients are otherwise only updated while ramping
+    b.setF(rF.getValue());
+    b.setQ(rQ.getValue());
     rampSamples = static_cast<unsigned long>(rampDuration * samplingRate * 0.001);    
   }
 
@@ -102,8 +106,12 @@ public:
   void reset() { b.reset(); }
 
   jl::sample process(jl::sample in) {
-    b.setF(*(rF.process(1)));
-    b.setQ(*(rQ.process(1)));
+    // only update the coefficients while ramping
+    jl::sample *f = rF.process(1);
+    jl::sample *q = rQ.process(1);
+
+    if (f != nullptr) { b.setF(*f); }
+    if (q != nullptr) { b.setQ(*q); }
 
     return b.process(in);
   }
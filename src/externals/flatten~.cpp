@@ -37,6 +37,7 @@
 
 #include "m_pd.h"
 #include "../dependencies/cpp-jl/src/dsp/effects/dynamics/Compress.h"
+#include "../common/BlockRamp.h"
 
 class PdFlattener;
 
@@ -70,9 +71,9 @@ private:
 
   jl::LogDomainFlattener flattener;
 
-  jl::Ramp<float, jl::sample> rMakeUp;
-  jl::Ramp<float, jl::sample> rRatio;
-  jl::Ramp<float, jl::sample> rKnee;
+  BlockRamp<float, jl::sample> rMakeUp;
+  BlockRamp<float, jl::sample> rRatio;
+  BlockRamp<float, jl::sample> rKnee;
 
   float samplingRate;
   float rampDuration;
@@ -110,10 +111,27 @@ public:
     jl::sample *r = rRatio.process(blockSize);
     jl::sample *k = rKnee.process(blockSize);
 
+    // null blocks are constant, use the ramps target values instead
+    if (m == nullptr && r == nullptr && k == nullptr) {
+      jl::sample mv = rMakeUp.getValue();
+      jl::sample rv = rRatio.getValue();
+      jl::sample kv = rKnee.getValue();
+
+      for (unsigned int i = 0; i < blockSize; ++i) {
+        out[i] = flattener.process(in1[i], in2[i], mv, rv, kv);
+      }
+
+      return;
+    }
+
     for (unsigned int i = 0; i < blockSize; ++i) {
       // jl::sample g = flattener.process(in1[i], in2[i], m[i], r[i], k[i]);
       // out[i] = static_cast<float>(g);
-      out[i] = flattener.process(in1[i], in2[i], m[i], r[i], k[i]);
+      out[i] = flattener.process(in1[i], in2[i],
+        m ? m[i] : rMakeUp.getValue(),
+        r ? r[i] : rRatio.getValue(),
+        k ? k[i] : rKnee.getValue()
+      );
     }
   }
 };
@@ -35,8 +35,35 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <new>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
 #include "m_pd.h"
-#include "../dependencies/cpp-jl/src/dsp/sampler/Gbend.h"
+#include "../common/Interpolation.h"
+#include "../common/SamplerVoice.h"
+#include "../common/DiskStream.h"
+#include "../common/SamplePool.h"
+#include "../common/TriggerQueue.h"
+#include "../common/Mipmap.h"
+
+// streamed files : preloaded head and ring buffer durations (ms), and max
+// playback speed (a bigger one would need a bigger window, 8 is 3 octaves up)
+#define JL_GBEND_STREAM_HEAD 500
+#define JL_GBEND_STREAM_RING 2000
+#define JL_GBEND_STREAM_MAX_RATE 8
+
+// octaves above the bound buffer's rate covered by the mipmaps
+#define JL_GBEND_MIPMAP_LEVELS 4
+
+enum {
+  JL_GBEND_INTERP_NEAREST = 0,
+  JL_GBEND_INTERP_LINEAR,
+  JL_GBEND_INTERP_HERMITE,
+  JL_GBEND_INTERP_SINC
+};
 
 class PdGbend;
 
@@ -50,6 +77,31 @@ typedef struct _gbend_tilde {
   t_symbol *x_arrayname;
   float x_arraysr;
 
+  // one interleaved array, or one array per channel (x_arrayname is the first)
+  std::vector<t_symbol *> x_arraynames;
+  unsigned int nb_channels;
+
+  // set with the pool message, played instead of the arrays
+  std::shared_ptr<SamplePool::Sample> pooled;
+
+  // what the voices were last bound to (see gbend_tilde_update)
+  std::vector<t_word *> bound_vecs;
+  int bound_frames;
+  SamplePool::Sample *bound_pool;
+  float bound_sr;
+  bool bound;
+  unsigned long bound_generation; // incremented on each binding
+
+  // created with the mipmap message : band limited copies of the bound content
+  // at 1/2, 1/4... of bound_sr, level 0 being bound_src
+  Mipmap *mipmap;
+  JlInterpSource bound_src;
+  std::shared_ptr<std::vector<float>> bound_buffer;
+
+  // kernel the voices (or the stream) read the sound with, chosen once per
+  // block
+  int interp;
+
   int x_npoints; // samples in buffer
   t_word *x_vec;
 
@@ -61,189 +113,988 @@ typedef struct _gbend_tilde {
 
   //************** ADDED ***************//
 
-  PdGbend *player;
-  t_outlet *x_out;
+  // contiguous pool of voices, a single one unless created with -voices
+  PdGbend *voices;
+  unsigned int nb_voices;
+  unsigned long nb_starts; // to find the oldest voice
+  bool steal_quietest;
+  float pitch; // given to the voices triggered by a bang
+
+  // one block per channel for the voice being processed, summed into mix
+  // (polyphonic mode only)
+  std::vector<t_sample> voice_out;
+  std::vector<t_sample *> voice_outs;
+  std::vector<t_sample> mix;
+
+  // optional, created with the open message : a file played from disk instead
+  // of the arrays, whose underruns and end are reported through stream_clock
+  DiskStream *stream;
+  t_clock *stream_clock;
+  t_canvas *canvas;
+  float stream_pitch;
+  float fadi; // ms
+  float fado; // ms
+  unsigned long stream_underruns;
+  int stream_ended;
+  int stream_end_offset;
+  int block_size;
+  float sr;
+
+  // optional, created with -position : playhead of the last triggered voice
+  // as a signal, and sample offsets appended to the end events
+  bool has_position;
+  unsigned int tracked; // voice index
+  std::vector<t_sample> position;
+  t_sample *position_vec;
+  t_outlet *position_out;
+
+  // starts scheduled with the start message, in ms since reference
+  TriggerQueue *starts;
+  double reference;
+  double ms_per_sample;
+  int segment; // offset in the current block of the samples being rendered
+  std::vector<t_sample *> segment_outs;
+
+  std::vector<t_sample *> s_outputs;
+  std::vector<t_outlet *> x_outs; // one per channel
   t_outlet *f_out;
 
 } t_gbend_tilde;
 
 //============================================================================//
 
-// example of class derived from Gbend to use the callbacks in pure data :
+// a voice reporting its events and buffer switches to the object :
 
-class PdGbend : public jl::Gbend {
+class PdGbend : public SamplerVoice {
 private:
   t_gbend_tilde *x;
+  unsigned int index;
 
 public:
+  // interleaved copy of the per channel arrays, kept alive until the engine
+  // switches to the next one (null when reading a garray directly)
+  std::shared_ptr<std::vector<float>> buffer;
+  std::shared_ptr<std::vector<float>> nextBuffer;
+
+  // voice allocation state, only used in polyphonic mode
+  unsigned long age;
+  t_sample level; // peak of the last block
+
+  // the content being played, and the mipmap level read from it. The copies
+  // of the level being read and of the one it replaced (crossfading) are kept
+  // alive here
+  unsigned long generation;
+  unsigned long nextGeneration;
+  unsigned int mipLevel;
+  std::shared_ptr<std::vector<float>> levelBuffer;
+  std::shared_ptr<std::vector<float>> fadingBuffer;
+
   PdGbend(unsigned int c = 1) :
-  Gbend(c) {}
+  SamplerVoice(c), x(nullptr), index(0), age(0), level(0), generation(0),
+  nextGeneration(0), mipLevel(0) {}
 
   virtual ~PdGbend() {}
 
-  void setObject(t_gbend_tilde *obj) {
+  void setObject(t_gbend_tilde *obj, unsigned int i = 0) {
     x = obj;
+    index = i;
   }
 
   void endReachCallback(int endReachType) {
-    outlet_float(x->f_out, endReachType);
+    if (x->nb_voices == 1 && !x->has_position) {
+      outlet_float(x->f_out, endReachType);
+    } else {
+      // the index (polyphonic mode), then the offset (with -position)
+      t_atom outv[3];
+      int outc = 1;
+      SETFLOAT(outv, endReachType);
+
+      if (x->nb_voices > 1) {
+        SETFLOAT(outv + outc, index);
+        outc++;
+      }
+
+      if (x->has_position) {
+        SETFLOAT(outv + outc, x->segment + getEventOffset());
+        outc++;
+      }
+
+      outlet_list(x->f_out, &s_list, outc, outv);
+    }
   }
 
-  void getPositionCallback(float position) {
-    t_atom outv;
-    SETFLOAT((t_atom *) &outv, position);
-    outlet_anything(x->f_out, gensym("position"), 1, (t_atom *)(&outv));
+  void getPositionCallback(float pos) {
+    t_atom outv[2];
+    SETFLOAT(outv, pos);
+    SETFLOAT(outv + 1, index);
+    outlet_anything(x->f_out, gensym("position"), x->nb_voices == 1 ? 1 : 2, outv);
   }
 
   void bufUpdatedCallback() {
     x->x_npoints = x->x_next_npoints;
     x->x_vec = x->x_next_vec;
+    buffer = nextBuffer;
+    generation = nextGeneration;
+    mipLevel = 0;
+    levelBuffer.reset();
+    fadingBuffer.reset();
   }
 };
 
 //============================================================================//
 
-void gbend_tilde_set(t_gbend_tilde *x, t_symbol *s, t_floatarg f) {
-  x->x_arrayname = s;
-  x->x_arraysr = (f > 0) ? f : sys_getsr();
-  t_garray *a;
-  t_word *vec;
-  int vecsize;
+// look the arrays up, frames being the size of the shortest one
+bool gbend_tilde_lookup(t_gbend_tilde *x, std::vector<t_word *>& vecs, int& frames) {
+  vecs.resize(x->x_arraynames.size());
+  frames = 0;
 
-  if (!(a = (t_garray *)pd_findbyclass(x->x_arrayname, garray_class))) {
-    if (*s->s_name) {
-      pd_error(x, "gbend~: %s: no such array", x->x_arrayname->s_name);
+  for (auto c = 0; c < x->x_arraynames.size(); ++c) {
+    t_symbol *name = x->x_arraynames[c];
+    t_garray *a;
+    int npoints;
+
+    if (!(a = (t_garray *)pd_findbyclass(name, garray_class))) {
+      if (*name->s_name) {
+        pd_error(x, "gbend~: %s: no such array", name->s_name);
+      }
+      x->x_next_vec = 0;
+      x->x_next_npoints = 0;
+      return false;
+    } else if (!garray_getfloatwords(a, &npoints, &vecs[c])) {
+      pd_error(x, "%s: bad template for gbend~", name->s_name);
+      x->x_next_vec = 0;
+      x->x_next_npoints = 0;
+      return false;
     }
-    x->x_next_vec = 0;
-    x->x_next_npoints = 0;
-  } else if (!garray_getfloatwords(a, &x->x_next_npoints, &x->x_next_vec)) {
-    pd_error(x, "%s: bad template for gbend~", x->x_arrayname->s_name);
-    x->x_next_vec = 0;
-    x->x_next_npoints = 0;
-  } else {
+
     garray_usedindsp(a);
+    frames = (c == 0) ? npoints : std::min(frames, npoints);
+  }
+
+  return true;
+}
+
+// a single array is read in place (interleaved if there are several channels),
+// several arrays (one per channel) are first copied into an interleaved buffer
+// that we own
+bool gbend_tilde_arrays_source(t_gbend_tilde *x,
+                               const std::vector<t_word *>& vecs, int frames,
+                               std::shared_ptr<std::vector<float>>& buffer,
+                               JlInterpSource& src) {
+  unsigned int nc = x->nb_channels;
+
+  if (vecs.size() == 1) {
     // this is normal, we just want to pass the address and parse the content
-    x->player->setBufferStride(reinterpret_cast<jl::sample *>(x->x_next_vec),
-                               x->x_next_npoints, x->x_arraysr, 1, sizeof(t_word));
+    src = { reinterpret_cast<const char *>(vecs[0]), frames / nc, nc, sizeof(t_word) };
+  } else if (vecs.size() == nc) {
+    buffer = std::make_shared<std::vector<float>>(frames * nc);
+
+    for (auto c = 0; c < nc; ++c) {
+      for (auto f = 0; f < frames; ++f) {
+        (*buffer)[f * nc + c] = vecs[c][f].w_float;
+      }
+    }
+
+    src = { reinterpret_cast<const char *>(buffer->data()), frames, nc, sizeof(float) };
+  } else {
+    pd_error(x, "gbend~: %d arrays given for %d channels",
+             static_cast<int>(vecs.size()), nc);
+    return false;
+  }
+
+  x->x_next_vec = vecs[0];
+  x->x_next_npoints = src.frames;
+  return true;
+}
+
+// a pooled file is shared with the other instances as long as it has as many
+// channels as we do, otherwise its channels are mapped to ours in a copy (the
+// last one being repeated, so that mono files play on all channels)
+void gbend_tilde_pool_source(t_gbend_tilde *x,
+                             std::shared_ptr<std::vector<float>>& buffer,
+                             JlInterpSource& src) {
+  unsigned int nc = x->nb_channels;
+  const SamplePool::Sample& sample = *x->pooled;
+
+  if (sample.channels == nc) {
+    // shares the ownership of the pooled sample
+    buffer = std::shared_ptr<std::vector<float>>(x->pooled, &x->pooled->data);
+  } else {
+    buffer = std::make_shared<std::vector<float>>(sample.frames * nc);
+
+    for (auto f = 0; f < sample.frames; ++f) {
+      for (unsigned int c = 0; c < nc; ++c) {
+        (*buffer)[f * nc + c] =
+          sample.data[f * sample.channels + std::min(c, sample.channels - 1)];
+      }
+    }
+  }
+
+  src = {
+    reinterpret_cast<const char *>(buffer->data()),
+    sample.frames, nc, sizeof(float)
+  };
+}
+
+// bind a voice to the bound buffer (mipmap level 0)
+void gbend_tilde_bind_base(t_gbend_tilde *x, PdGbend& v) {
+  v.nextBuffer = x->bound_buffer;
+  v.nextGeneration = x->bound_generation;
+  v.setBuffer(x->bound_src, x->bound_sr);
+}
+
+// pass the arrays or the pooled file to the voices, and start building their
+// mipmap levels (if any). If cached, nothing is done unless an array was
+// resized or moved since the last call (or the pool or samplerate changed),
+// which keeps dsp restarts cheap : the
+// copies made from the arrays and the background builds are kept too, the
+// update message being there to refresh them after writing into the arrays
+void gbend_tilde_update(t_gbend_tilde *x, bool cached = false) {
+  unsigned int nc = x->nb_channels;
+  std::vector<t_word *> vecs;
+  int frames = 0;
+  float sr;
+
+  if (x->pooled != nullptr) {
+    sr = x->pooled->samplingRate;
+  } else if (gbend_tilde_lookup(x, vecs, frames)) {
+    sr = x->x_arraysr;
+  } else {
+    x->bound = false;
+    return;
+  }
+
+  if (cached && x->bound && vecs == x->bound_vecs &&
+      frames == x->bound_frames && x->pooled.get() == x->bound_pool &&
+      sr == x->bound_sr) {
+    return;
+  }
+
+  std::shared_ptr<std::vector<float>> buffer;
+  JlInterpSource src;
+
+  if (x->pooled != nullptr) {
+    gbend_tilde_pool_source(x, buffer, src);
+  } else if (!gbend_tilde_arrays_source(x, vecs, frames, buffer, src)) {
+    x->bound = false;
+    return;
+  }
+
+  x->bound_vecs = vecs;
+  x->bound_frames = frames;
+  x->bound_pool = x->pooled.get();
+  x->bound_sr = sr;
+  x->bound = true;
+  x->bound_generation++;
+  x->bound_src = src;
+  x->bound_buffer = buffer;
+
+  for (auto i = 0; i < x->nb_voices; ++i) {
+    gbend_tilde_bind_base(x, x->voices[i]);
+  }
+
+  if (x->mipmap == nullptr) {
+    return;
+  }
+
+  // the levels are built from a packed copy we own, as arrays may change
+  std::shared_ptr<std::vector<float>> packed = buffer;
+
+  if (packed == nullptr) {
+    packed = std::make_shared<std::vector<float>>(src.frames * nc);
+
+    for (auto f = 0; f < src.frames; ++f) {
+      for (auto c = 0; c < nc; ++c) {
+        (*packed)[f * nc + c] = src.get(f, c);
+      }
+    }
+  }
+
+  x->mipmap->build(packed, src.frames, nc, sr, JL_GBEND_MIPMAP_LEVELS);
+}
+
+// back to the arrays (or pool)
+void gbend_tilde_close(t_gbend_tilde *x) {
+  // joins the reader thread
+  delete x->stream;
+  x->stream = nullptr;
+}
+
+// open <wav file> : play the file from disk instead of the arrays, until the
+// next set or close message
+void gbend_tilde_open(t_gbend_tilde *x, t_symbol *s) {
+  char dir[MAXPDSTRING], *name;
+  int fd = canvas_open(x->canvas, s->s_name, "", dir, &name, MAXPDSTRING, 1);
+
+  if (fd < 0) {
+    pd_error(x, "gbend~: %s: can't open", s->s_name);
+    return;
+  }
+
+  sys_close(fd);
+  std::string path = std::string(dir) + "/" + name;
+  DiskStream *stream = new DiskStream(JL_GBEND_STREAM_HEAD, JL_GBEND_STREAM_RING);
+
+  if (!stream->open(path.c_str())) {
+    pd_error(x, "gbend~: %s: not a supported wav file", s->s_name);
+    delete stream;
+    return;
   }
+
+  stream->prepare(x->block_size, JL_GBEND_STREAM_MAX_RATE);
+  gbend_tilde_close(x);
+  x->stream = stream;
 }
 
+// pool <wav file> : play the file instead of the arrays, until the next set
+// message. It is decoded once and shared with all the gbend~ pooling it
+void gbend_tilde_pool(t_gbend_tilde *x, t_symbol *s) {
+  char dir[MAXPDSTRING], *name;
+  int fd = canvas_open(x->canvas, s->s_name, "", dir, &name, MAXPDSTRING, 1);
+
+  if (fd < 0) {
+    pd_error(x, "gbend~: %s: can't open", s->s_name);
+    return;
+  }
+
+  sys_close(fd);
+  auto sample = SamplePool::get(std::string(dir) + "/" + name);
+
+  if (sample == nullptr) {
+    pd_error(x, "gbend~: %s: not a supported wav file", s->s_name);
+    return;
+  }
+
+  x->pooled = sample;
+  gbend_tilde_close(x);
+  gbend_tilde_update(x);
+}
+
+// output what happened during the last blocks
+void gbend_tilde_stream_tick(t_gbend_tilde *x) {
+  if (x->stream_underruns > 0) {
+    t_atom outv;
+    SETFLOAT(&outv, x->stream_underruns);
+    outlet_anything(x->f_out, gensym("underrun"), 1, &outv);
+    x->stream_underruns = 0;
+  }
+
+  if (x->stream_ended >= 0) {
+    if (x->has_position) {
+      t_atom outv[2];
+      SETFLOAT(outv, x->stream_ended);
+      SETFLOAT(outv + 1, x->stream_end_offset);
+      outlet_list(x->f_out, &s_list, 2, outv);
+    } else {
+      outlet_float(x->f_out, x->stream_ended);
+    }
+
+    x->stream_ended = -1;
+  }
+}
+
+// set <array(s)> <array samplerate (optional)>
+void gbend_tilde_set(t_gbend_tilde *x, t_symbol *s, int argc, t_atom *argv) {
+  x->x_arraynames.clear();
+  x->x_arraysr = sys_getsr();
+
+  for (auto i = 0; i < argc; ++i) {
+    if (argv[i].a_type == A_SYMBOL) {
+      x->x_arraynames.push_back(atom_getsymbol(argv + i));
+    } else if (atom_getfloat(argv + i) > 0) {
+      x->x_arraysr = atom_getfloat(argv + i);
+    }
+  }
+
+  if (x->x_arraynames.empty()) {
+    x->x_arraynames.push_back(gensym(""));
+  }
+
+  x->x_arrayname = x->x_arraynames[0];
+  x->pooled.reset();
+  gbend_tilde_close(x);
+  gbend_tilde_update(x);
+}
+
+// update : rebind the arrays after writing into them, for the copies made in
+// mipmap mode or from several arrays
+void gbend_tilde_rebind(t_gbend_tilde *x) {
+  if (x->pooled == nullptr) {
+    gbend_tilde_update(x);
+  }
+}
+
+//=========================== VOICE ALLOCATION ===============================//
+
+// a free voice if any, otherwise the oldest or the quietest playing one
+PdGbend *gbend_tilde_allocate(t_gbend_tilde *x) {
+  PdGbend *voice = x->voices;
+
+  for (auto i = 0; i < x->nb_voices; ++i) {
+    PdGbend *v = x->voices + i;
+
+    if (!v->isPlaying()) {
+      return v;
+    }
+
+    if (x->steal_quietest ? (v->level < voice->level) : (v->age < voice->age)) {
+      voice = v;
+    }
+  }
+
+  return voice;
+}
+
+// a stolen voice is restarted, using its interrupt fade
+void gbend_tilde_trigger(t_gbend_tilde *x, PdGbend *voice, float pitch) {
+  voice->setPitch(pitch);
+  voice->age = ++x->nb_starts;
+  voice->start();
+  x->tracked = static_cast<unsigned int>(voice - x->voices);
+}
 
 void gbend_tilde_bang(t_gbend_tilde *x) {
-  x->player->start();
+  if (x->stream != nullptr) {
+    x->stream_pitch = x->pitch;
+    x->stream->start(x->fadi * 0.001f * x->sr);
+    return;
+  }
+
+  gbend_tilde_trigger(x, gbend_tilde_allocate(x), x->pitch);
+}
+
+// trigger a voice with its own pitch (semitones)
+void gbend_tilde_note(t_gbend_tilde *x, t_floatarg f) {
+  if (x->stream != nullptr) {
+    x->stream_pitch = static_cast<float>(f);
+    x->stream->start(x->fadi * 0.001f * x->sr);
+    return;
+  }
+
+  gbend_tilde_trigger(x, gbend_tilde_allocate(x), static_cast<float>(f));
+}
+
+// start <delay (ms)> : trig a voice like bang, at the exact sample
+void gbend_tilde_start(t_gbend_tilde *x, t_floatarg f) {
+  x->starts->add(clock_gettimesince(x->reference) + std::max(static_cast<float>(f), 0.f));
 }
 
 void gbend_tilde_stop(t_gbend_tilde *x) {
-  x->player->stop();
+  x->starts->clear();
+
+  if (x->stream != nullptr) {
+    x->stream->stop(x->fado * 0.001f * x->sr);
+  }
+
+  for (auto i = 0; i < x->nb_voices; ++i) {
+    x->voices[i].stop();
+  }
+}
+
+// voice stealing policy when all voices are playing : oldest or quietest
+void gbend_tilde_steal(t_gbend_tilde *x, t_symbol *s) {
+  if (s == gensym("quietest")) {
+    x->steal_quietest = true;
+  } else if (s == gensym("oldest")) {
+    x->steal_quietest = false;
+  } else {
+    pd_error(x, "gbend~: unknown steal policy %s (oldest / quietest)", s->s_name);
+  }
 }
 
 //=========================== PARAMETER SETTERS ==============================//
 
+// parameters are shared by all the voices
+template <typename F>
+void gbend_tilde_foreach(t_gbend_tilde *x, F f) {
+  for (auto i = 0; i < x->nb_voices; ++i) {
+    f(x->voices[i]);
+  }
+}
+
 void gbend_tilde_pitch(t_gbend_tilde *x, t_floatarg f) {
-  x->player->setPitch(static_cast<float>(f));
+  x->pitch = static_cast<float>(f);
+  gbend_tilde_foreach(x, [f](PdGbend& v) { v.setPitch(static_cast<float>(f)); });
 }
 
 void gbend_tilde_fade(t_gbend_tilde *x, t_floatarg f) {
-  x->player->setFades(static_cast<float>(f));
+  x->fadi = x->fado = static_cast<float>(f);
+  gbend_tilde_foreach(x, [f](PdGbend& v) { v.setFades(static_cast<float>(f)); });
 }
 
 void gbend_tilde_fadi(t_gbend_tilde *x, t_floatarg f) {
-  x->player->setFadeIn(static_cast<float>(f));
+  x->fadi = static_cast<float>(f);
+  gbend_tilde_foreach(x, [f](PdGbend& v) { v.setFadeIn(static_cast<float>(f)); });
 }
 
 void gbend_tilde_fado(t_gbend_tilde *x, t_floatarg f) {
-  x->player->setFadeOut(static_cast<float>(f));
+  x->fado = static_cast<float>(f);
+  gbend_tilde_foreach(x, [f](PdGbend& v) { v.setFadeOut(static_cast<float>(f)); });
 }
 
 void gbend_tilde_interrupt(t_gbend_tilde *x, t_floatarg f) {
-  x->player->setInterrupt(static_cast<float>(f));
+  gbend_tilde_foreach(x, [f](PdGbend& v) { v.setInterrupt(static_cast<float>(f)); });
 }
 
 void gbend_tilde_beg(t_gbend_tilde *x, t_floatarg f) {
-  x->player->setBegin(static_cast<float>(f));
+  gbend_tilde_foreach(x, [f](PdGbend& v) { v.setBegin(static_cast<float>(f)); });
 }
 
 void gbend_tilde_end(t_gbend_tilde *x, t_floatarg f) {
-  x->player->setEnd(static_cast<float>(f));
+  gbend_tilde_foreach(x, [f](PdGbend& v) { v.setEnd(static_cast<float>(f)); });
 }
 
 void gbend_tilde_loop(t_gbend_tilde *x, t_floatarg f) {
-  x->player->setLoop(f != 0);
+  gbend_tilde_foreach(x, [f](PdGbend& v) { v.setLoop(f != 0); });
 }
 
 void gbend_tilde_rvs(t_gbend_tilde *x, t_floatarg f) {
-  x->player->setRvs(f != 0);
+  gbend_tilde_foreach(x, [f](PdGbend& v) { v.setRvs(f != 0); });
 }
 
 void gbend_tilde_get_position(t_gbend_tilde *x) {
-  x->player->getPosition();
+  for (auto i = 0; i < x->nb_voices; ++i) {
+    if (x->nb_voices == 1 || x->voices[i].isPlaying()) {
+      x->voices[i].getPosition();
+    }
+  }
+}
+
+// nearest / linear : cheaper, for many voices or small machines
+// hermite : 4 points, 3rd order (default)
+// sinc : 16 points windowed sinc, for pitched down sounds
+// the voices and streamed files all read the sound with the same kernel
+void gbend_tilde_interp(t_gbend_tilde *x, t_symbol *s) {
+  if (s == gensym("nearest")) {
+    x->interp = JL_GBEND_INTERP_NEAREST;
+  } else if (s == gensym("linear")) {
+    x->interp = JL_GBEND_INTERP_LINEAR;
+  } else if (s == gensym("hermite")) {
+    x->interp = JL_GBEND_INTERP_HERMITE;
+  } else if (s == gensym("sinc")) {
+    x->interp = JL_GBEND_INTERP_SINC;
+  } else {
+    pd_error(x, "gbend~: unknown interpolation %s (nearest / linear / hermite / sinc)",
+             s->s_name);
+  }
+}
+
+// mipmap <on/off (1/0)> : play band limited copies of the sound when pitching
+// up by more than an octave, built in the background
+void gbend_tilde_mipmap(t_gbend_tilde *x, t_floatarg f) {
+  if ((f != 0) == (x->mipmap != nullptr)) {
+    return;
+  }
+
+  if (f != 0) {
+    x->mipmap = new Mipmap();
+  } else {
+    delete x->mipmap;
+    x->mipmap = nullptr;
+  }
+
+  gbend_tilde_update(x);
 }
 
 void gbend_tilde_setsr(t_gbend_tilde *x, t_floatarg f) {
-  x->player->setSamplingRate(static_cast<float>(f));
+  x->sr = static_cast<float>(f);
+  gbend_tilde_foreach(x, [f](PdGbend& v) { v.setSamplingRate(static_cast<float>(f)); });
 }
 
 //============================ DSP OPERATIONS ================================//
 
+void gbend_tilde_perform_stream(t_gbend_tilde *x, t_sample *in, t_sample **outs,
+                                t_sample *position, int n) {
+  DiskStream *stream = x->stream;
+  float **fouts = (float **)outs;
+  double rate = std::exp2(x->stream_pitch / 12.) * stream->getSamplingRate() / x->sr;
+
+  // the kernel is chosen once per block
+  switch (x->interp) {
+    case JL_GBEND_INTERP_NEAREST:
+      stream->process<JlInterpNearest>((float *)in, fouts, x->nb_channels, n, rate, position);
+      break;
+    case JL_GBEND_INTERP_LINEAR:
+      stream->process<JlInterpLinear>((float *)in, fouts, x->nb_channels, n, rate, position);
+      break;
+    case JL_GBEND_INTERP_SINC:
+      stream->process<JlInterpSinc<>>((float *)in, fouts, x->nb_channels, n, rate, position);
+      break;
+    default:
+      stream->process<JlInterpHermite>((float *)in, fouts, x->nb_channels, n, rate, position);
+      break;
+  }
+
+  unsigned long underruns = stream->takeUnderruns();
+  int ended = stream->takeEnded();
+
+  if (underruns > 0 || ended >= 0) {
+    x->stream_underruns += underruns;
+    x->stream_ended = (ended >= 0) ? ended : x->stream_ended;
+    x->stream_end_offset = x->segment + stream->getEndOffset();
+    clock_delay(x->stream_clock, 0);
+  }
+}
+
+// switch a playing voice to the mipmap level allowing to play at its pitch plus
+// detune (semitones) without reading the content faster than the level's rate,
+// or to the closest one built so far, level 0 being the bound buffer. Voices
+// still playing a previous binding keep their level until their next start
+void gbend_tilde_pick_level(t_gbend_tilde *x, PdGbend& v, float detune) {
+  if (!v.isPlaying() || v.generation != x->bound_generation) {
+    return;
+  }
+
+  unsigned int l = 0;
+
+  if (x->mipmap != nullptr && x->mipmap->getReadyLevels() > 0) {
+    double rate = std::exp2((v.getPitch() + detune) / 12.) * x->bound_sr / x->sr;
+    l = rate > 1 ? static_cast<unsigned int>(std::ceil(std::log2(rate) - 1e-6)) : 0;
+    l = std::min(l, x->mipmap->getReadyLevels() - 1);
+  }
+
+  if (l == v.mipLevel) {
+    return;
+  }
+
+  v.fadingBuffer = v.levelBuffer;
+
+  if (l == 0) {
+    v.levelBuffer.reset();
+    v.setSource(x->bound_src, x->bound_sr);
+  } else {
+    const Mipmap::Level& level = x->mipmap->getLevel(l);
+    v.levelBuffer = level.data;
+    v.setSource({
+      reinterpret_cast<const char *>(level.data->data()),
+      level.frames, x->nb_channels, sizeof(float)
+    }, level.samplingRate);
+  }
+
+  v.mipLevel = l;
+}
+
+// play the voices for the samples offset to offset + n of the current block,
+// into the outputs or, in polyphonic mode, summed into mix
+template <class Kernel>
+void gbend_tilde_play(t_gbend_tilde *x, t_sample *in, int offset, int n,
+                      t_sample *position) {
+  unsigned int nc = x->nb_channels;
+
+  // the levels are picked once per segment, for the highest detune in it
+  float detune = n > 0 ? *std::max_element(in, in + n) : 0.f;
+
+  if (x->nb_voices == 1) {
+    gbend_tilde_pick_level(x, *x->voices, detune);
+    x->voices->process<Kernel>((float *)in, (float **)x->segment_outs.data(), n,
+                               (float *)position);
+    return;
+  }
+
+  t_sample **outs = x->voice_outs.data();
+
+  for (auto i = 0; i < x->nb_voices; ++i) {
+    PdGbend& v = x->voices[i];
+
+    if (!v.isPlaying()) {
+      if (position != nullptr && i == x->tracked) {
+        std::fill(position, position + n, v.getNormalizedPosition());
+      }
+
+      continue;
+    }
+
+    gbend_tilde_pick_level(x, v, detune);
+    v.process<Kernel>((float *)in, (float **)outs, n,
+                      (float *)(i == x->tracked ? position : nullptr));
+    t_sample peak = 0;
+
+    for (auto c = 0; c < nc; ++c) {
+      t_sample *mix = x->mix.data() + c * x->block_size + offset;
+
+      for (auto j = 0; j < n; ++j) {
+        mix[j] += outs[c][j];
+        peak = std::max(peak, std::abs(outs[c][j]));
+      }
+    }
+
+    v.level = (offset == 0) ? peak : std::max(v.level, peak);
+  }
+}
+
+// render the samples offset to offset + n of the current block, between two
+// scheduled starts
+void gbend_tilde_render(t_gbend_tilde *x, t_sample *in, int offset, int n) {
+  t_sample *position = x->has_position ? x->position.data() + offset : nullptr;
+  x->segment = offset;
+  in += offset;
+
+  for (auto c = 0; c < x->nb_channels; ++c) {
+    x->segment_outs[c] = x->s_outputs[c] + offset;
+  }
+
+  if (x->stream != nullptr) {
+    gbend_tilde_perform_stream(x, in, x->segment_outs.data(), position, n);
+    return;
+  }
+
+  // the kernel is chosen once per segment
+  switch (x->interp) {
+    case JL_GBEND_INTERP_NEAREST:
+      gbend_tilde_play<JlInterpNearest>(x, in, offset, n, position);
+      break;
+    case JL_GBEND_INTERP_LINEAR:
+      gbend_tilde_play<JlInterpLinear>(x, in, offset, n, position);
+      break;
+    case JL_GBEND_INTERP_SINC:
+      gbend_tilde_play<JlInterpSinc<>>(x, in, offset, n, position);
+      break;
+    default:
+      gbend_tilde_play<JlInterpHermite>(x, in, offset, n, position);
+      break;
+  }
+}
+
 t_int *gbend_tilde_perform(t_int *w) {
   t_gbend_tilde *x = (t_gbend_tilde *)(w[1]);
   t_sample *in = (t_sample *)(w[2]);
-  t_sample *out = (t_sample *)(w[3]);
-  int n = (int)(w[4]); // VECTOR SIZE
+  int n = (int)(w[3]); // VECTOR SIZE
+  unsigned int nc = x->nb_channels;
+  bool mixing = (x->stream == nullptr && x->nb_voices > 1);
 
-  t_sample **outs = &out;
+  // in and out may share the same vector, so in polyphonic mode we mix into
+  // our own blocks and only copy them to the outputs once all the voices have
+  // read in (and so for the position)
+  if (mixing) {
+    std::fill(x->mix.begin(), x->mix.begin() + nc * n, 0);
+  }
+
+  // this block spans the last n samples before now, as in vline~
+  double start = clock_gettimesince(x->reference) - n * x->ms_per_sample;
 
-  x->player->process((jl::sample *)in, (jl::sample **)outs, n);
+  x->starts->run(start, x->ms_per_sample, n,
+    [x, in](int offset, int length) { gbend_tilde_render(x, in, offset, length); },
+    [x]() { gbend_tilde_bang(x); }
+  );
+
+  if (mixing) {
+    for (auto c = 0; c < nc; ++c) {
+      std::copy(x->mix.data() + c * n, x->mix.data() + (c + 1) * n, x->s_outputs[c]);
+    }
+  }
+
+  if (x->has_position) {
+    std::copy(x->position.begin(), x->position.begin() + n, x->position_vec);
+  }
 
-  return (w + 5);
+  return (w + 4);
 }
 
 void gbend_tilde_dsp(t_gbend_tilde *x, t_signal **sp) {
-  
-  gbend_tilde_setsr(x, sys_getsr());
-  gbend_tilde_set(x, x->x_arrayname, x->x_arraysr);
+  // the local rate, which differs from sys_getsr in a resampled subpatch
+  float sr = sp[0]->s_sr;
+
+  if (x->sr != sr) {
+    gbend_tilde_setsr(x, sr);
+  }
+
+  gbend_tilde_update(x, true);
+
+  for (auto c = 0; c < x->nb_channels; ++c) {
+    x->s_outputs[c] = sp[c + 1]->s_vec;
+  }
+
+  x->block_size = sp[0]->s_n;
+  x->ms_per_sample = 1000. / sr;
+
+  for (auto i = 0; i < x->nb_voices; ++i) {
+    x->voices[i].prepare(x->block_size);
+  }
+
+  x->segment_outs.resize(x->nb_channels);
+
+  if (x->has_position) {
+    x->position.resize(sp[0]->s_n);
+    x->position_vec = sp[x->nb_channels + 1]->s_vec;
+  }
+
+  if (x->stream != nullptr) {
+    x->stream->prepare(x->block_size, JL_GBEND_STREAM_MAX_RATE);
+  }
+
+  if (x->nb_voices > 1) {
+    x->voice_out.resize(x->nb_channels * sp[0]->s_n);
+    x->voice_outs.resize(x->nb_channels);
+    x->mix.resize(x->nb_channels * sp[0]->s_n);
 
-  dsp_add(gbend_tilde_perform, 4, x,
-          sp[0]->s_vec, sp[1]->s_vec, sp[0]->s_n);
+    for (auto c = 0; c < x->nb_channels; ++c) {
+      x->voice_outs[c] = x->voice_out.data() + c * sp[0]->s_n;
+    }
+  }
+
+  dsp_add(gbend_tilde_perform, 3, x, sp[0]->s_vec, sp[0]->s_n);
 
 }
 
 //======================= CONSTRUCTOR / DESTRUCTOR ===========================//
 
-void *gbend_tilde_new(t_symbol *s) {
+void *gbend_tilde_new(t_symbol *s, int argc, t_atom *argv) {
   /*
    * call the "constructor" of the parent-class
    * this will reserve enough memory to hold "t_gbend_tilde"
    */
   t_gbend_tilde *x = (t_gbend_tilde *)pd_new(gbend_tilde_class);
 
-  x->x_arrayname = s;
+  // pd_new only zeroes the memory : construct the C++ members in place, they
+  // are destroyed in gbend_tilde_free
+  new (&x->x_arraynames) std::vector<t_symbol *>();
+  new (&x->pooled) std::shared_ptr<SamplePool::Sample>();
+  new (&x->bound_vecs) std::vector<t_word *>();
+  new (&x->bound_buffer) std::shared_ptr<std::vector<float>>();
+  new (&x->voice_out) std::vector<t_sample>();
+  new (&x->voice_outs) std::vector<t_sample *>();
+  new (&x->mix) std::vector<t_sample>();
+  new (&x->position) std::vector<t_sample>();
+  new (&x->segment_outs) std::vector<t_sample *>();
+  new (&x->s_outputs) std::vector<t_sample *>();
+  new (&x->x_outs) std::vector<t_outlet *>();
+
+  x->x_arrayname = gensym("");
   x->x_arraysr = sys_getsr();
   //if(x->x_arrayname == gensym("")) post("no table affected");
 
   x->x_vec = 0;
   // x->x_f = 0;
 
-  x->player = new PdGbend(1);
-  x->player->setObject(x);
+  unsigned int nbVoices = 1;
+  int nbChannels = 0;
+  bool hasPosition = false;
+  int i = 0;
+
+  // optional table name(s), then flags
+  while (i < argc && argv[i].a_type == A_SYMBOL &&
+         atom_getsymbol(argv + i)->s_name[0] != '-') {
+    x->x_arraynames.push_back(atom_getsymbol(argv + i++));
+  }
+
+  for (; i < argc; ++i) {
+    if (atom_getsymbol(argv + i) == gensym("-voices") && i + 1 < argc) {
+      auto n = static_cast<int>(atom_getfloat(argv + ++i));
+      nbVoices = n > 1 ? static_cast<unsigned int>(n) : 1;
+    } else if (atom_getsymbol(argv + i) == gensym("-channels") && i + 1 < argc) {
+      nbChannels = static_cast<int>(atom_getfloat(argv + ++i));
+    } else if (atom_getsymbol(argv + i) == gensym("-position")) {
+      hasPosition = true;
+    }
+  }
+
+  if (x->x_arraynames.empty()) {
+    x->x_arraynames.push_back(gensym(""));
+  }
+
+  // defaults to one channel per array
+  x->x_arrayname = x->x_arraynames[0];
+  x->nb_channels = nbChannels > 0
+                 ? static_cast<unsigned int>(nbChannels)
+                 : static_cast<unsigned int>(x->x_arraynames.size());
+
+  x->nb_voices = nbVoices;
+  x->nb_starts = 0;
+  x->steal_quietest = false;
+  x->interp = JL_GBEND_INTERP_HERMITE;
+  x->bound = false;
+  x->mipmap = nullptr;
+
+  x->stream = nullptr;
+  x->stream_clock = clock_new(x, (t_method)gbend_tilde_stream_tick);
+  x->canvas = canvas_getcurrent();
+  x->stream_pitch = 0;
+  x->fadi = x->fado = 5; // as in SamplerVoice
+  x->stream_underruns = 0;
+  x->stream_ended = -1;
+  x->stream_end_offset = 0;
+  x->has_position = hasPosition;
+  x->tracked = 0;
+  x->starts = new TriggerQueue();
+  x->reference = clock_getlogicaltime();
+  x->ms_per_sample = 1000. / sys_getsr();
+  x->segment = 0;
+  x->block_size = sys_getblksize();
+  x->sr = sys_getsr();
+  x->pitch = 0;
+
+  // placement new to keep the voices contiguous
+  x->voices = static_cast<PdGbend *>(::operator new(sizeof(PdGbend) * nbVoices));
+
+  for (auto v = 0; v < nbVoices; ++v) {
+    new (x->voices + v) PdGbend(x->nb_channels);
+    x->voices[v].setObject(x, v);
+    x->voices[v].prepare(x->block_size);
+  }
 
   gbend_tilde_setsr(x, sys_getsr());
-  gbend_tilde_set(x, x->x_arrayname, x->x_arraysr);
+  gbend_tilde_update(x);
+
+  x->s_outputs.resize(x->nb_channels);
+  x->x_outs.resize(x->nb_channels);
+
+  for (auto c = 0; c < x->nb_channels; ++c) {
+    x->x_outs[c] = outlet_new(&x->x_obj, &s_signal);
+  }
+
+  x->position_out = hasPosition ? outlet_new(&x->x_obj, &s_signal) : nullptr;
 
-  x->x_out = outlet_new(&x->x_obj, &s_signal);
   x->f_out = outlet_new(&x->x_obj, &s_anything);
 
   return (void *)x;
 }
 
 void gbend_tilde_free(t_gbend_tilde *x) {
-  delete x->player;
+  delete x->mipmap;
+  x->bound_buffer.reset();
+  gbend_tilde_close(x);
+  x->pooled.reset();
+  clock_free(x->stream_clock);
+
+  for (auto v = 0; v < x->nb_voices; ++v) {
+    x->voices[v].~PdGbend();
+  }
+
+  ::operator delete(x->voices);
   // delete[] x->x_next_vec;
   x->x_next_vec = 0;
   x->x_next_npoints = 0;
 
-  outlet_free(x->x_out);
+  for (auto outlet : x->x_outs) {
+    outlet_free(outlet);
+  }
+
+  if (x->position_out != nullptr) {
+    outlet_free(x->position_out);
+  }
+
   outlet_free(x->f_out);
+  delete x->starts;
+
+  using symbols = std::vector<t_symbol *>;
+  using words = std::vector<t_word *>;
+  using samples = std::vector<t_sample>;
+  using vectors = std::vector<t_sample *>;
+  using outlets = std::vector<t_outlet *>;
+  using pooledSample = std::shared_ptr<SamplePool::Sample>;
+  using buffer = std::shared_ptr<std::vector<float>>;
+
+  x->x_arraynames.~symbols();
+  x->pooled.~pooledSample();
+  x->bound_vecs.~words();
+  x->bound_buffer.~buffer();
+  x->voice_out.~samples();
+  x->voice_outs.~vectors();
+  x->mix.~samples();
+  x->position.~samples();
+  x->segment_outs.~vectors();
+  x->s_outputs.~vectors();
+  x->x_outs.~outlets();
 }
 
 //============================ SETUP FUNCTION ================================//
@@ -261,13 +1112,17 @@ void gbend_tilde_setup(void) {
     (t_method)gbend_tilde_free,                   /* the object's destructor */
     sizeof(t_gbend_tilde),                        /* the size of the data-space */
     CLASS_DEFAULT,                                /* a normal pd object */
-    A_DEFSYM,                                     /* arg type (default associated table name) */
+    A_GIMME,                                      /* arg types (table name and flags) */
     0);                                           /* no creation arguments ? */
 
   class_addbang(gbend_tilde_class, gbend_tilde_bang);
   class_addmethod(gbend_tilde_class, (t_method)gbend_tilde_dsp, gensym("dsp"), A_NULL);
-  class_addmethod(gbend_tilde_class, (t_method)gbend_tilde_set, gensym("set"), A_DEFSYM, A_DEFFLOAT, 0);
+  class_addmethod(gbend_tilde_class, (t_method)gbend_tilde_set, gensym("set"), A_GIMME, 0);
+  class_addmethod(gbend_tilde_class, (t_method)gbend_tilde_rebind, gensym("update"), A_NULL);
+  class_addmethod(gbend_tilde_class, (t_method)gbend_tilde_start, gensym("start"), A_DEFFLOAT, 0);
   class_addmethod(gbend_tilde_class, (t_method)gbend_tilde_stop, gensym("stop"), A_NULL);
+  class_addmethod(gbend_tilde_class, (t_method)gbend_tilde_note, gensym("note"), A_DEFFLOAT, 0);
+  class_addmethod(gbend_tilde_class, (t_method)gbend_tilde_steal, gensym("steal"), A_DEFSYM, 0);
   class_addmethod(gbend_tilde_class, (t_method)gbend_tilde_get_position, gensym("position"), A_NULL);
   class_addmethod(gbend_tilde_class, (t_method)gbend_tilde_pitch, gensym("pitch"), A_DEFFLOAT, 0);
   class_addmethod(gbend_tilde_class, (t_method)gbend_tilde_fade, gensym("fade"), A_DEFFLOAT, 0);
@@ -279,6 +1134,11 @@ void gbend_tilde_setup(void) {
   class_addmethod(gbend_tilde_class, (t_method)gbend_tilde_rvs, gensym("rvs"), A_DEFFLOAT, 0);
   class_addmethod(gbend_tilde_class, (t_method)gbend_tilde_loop, gensym("loop"), A_DEFFLOAT, 0);
   class_addmethod(gbend_tilde_class, (t_method)gbend_tilde_setsr, gensym("setsr"), A_DEFFLOAT, 0);
+  class_addmethod(gbend_tilde_class, (t_method)gbend_tilde_interp, gensym("interp"), A_DEFSYM, 0);
+  class_addmethod(gbend_tilde_class, (t_method)gbend_tilde_mipmap, gensym("mipmap"), A_DEFFLOAT, 0);
+  class_addmethod(gbend_tilde_class, (t_method)gbend_tilde_open, gensym("open"), A_DEFSYM, 0);
+  class_addmethod(gbend_tilde_class, (t_method)gbend_tilde_close, gensym("close"), A_NULL);
+  class_addmethod(gbend_tilde_class, (t_method)gbend_tilde_pool, gensym("pool"), A_DEFSYM, 0);
 
   CLASS_MAINSIGNALIN(gbend_tilde_class, t_gbend_tilde, x_f);
 }
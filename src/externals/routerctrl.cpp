@@ -35,13 +35,151 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <vector>
+#include <algorithm>
+#include <cstdint>
 #include "m_pd.h"
-#include "../dependencies/cpp-jl/src/control/utilities/routing.h"
+#include "../common/RoutingShared.h"
+
+// connection bits per float atom in packed (de)serialization. pd saves floats
+// with 6 significant digits (%g), so words must stay below 10^6 to survive a
+// save / load cycle : 2^19 - 1 = 524287 is the largest all-ones word that does
+#define JL_ROUTERCTRL_PACKED_BITS 19
 
 static t_class *routerctrl_class;
 
 //----------------------------------------------------------------------------//
 
+// Transitive closure of the sends connections graph, one bitset row per send :
+// bit v of row u is set when there is a path from u to v. Checking if a new
+// edge closes a loop is then a single bit test. Inserting an edge updates the
+// closure incrementally, while removing one only marks it dirty, it is rebuilt
+// from the connections the next time it is needed.
+
+class ReachabilityIndex {
+private:
+  unsigned int n;
+  unsigned int words; // per row
+  std::vector<uint64_t> reach;
+  bool dirty;
+
+  uint64_t* row(unsigned int u) { return reach.data() + u * words; }
+
+  bool test(unsigned int u, unsigned int v) {
+    return (row(u)[v >> 6] >> (v & 63)) & 1;
+  }
+
+  void set(unsigned int u, unsigned int v) {
+    row(u)[v >> 6] |= uint64_t(1) << (v & 63);
+  }
+
+  // connections[from + to * n] is the edge from -> to
+  void rebuild(const std::vector<bool>& connections) {
+    std::fill(reach.begin(), reach.end(), 0);
+
+    for (unsigned int to = 0; to < n; ++to) {
+      for (unsigned int from = 0; from < n; ++from) {
+        if (connections[from + to * n]) {
+          set(from, to);
+        }
+      }
+    }
+
+    // warshall, one row at a time
+    for (unsigned int k = 0; k < n; ++k) {
+      uint64_t* rk = row(k);
+
+      for (unsigned int u = 0; u < n; ++u) {
+        if (test(u, k)) {
+          uint64_t* ru = row(u);
+          for (unsigned int w = 0; w < words; ++w) { ru[w] |= rk[w]; }
+        }
+      }
+    }
+
+    dirty = false;
+  }
+
+public:
+  ReachabilityIndex(unsigned int size) :
+  n(size), words((size + 63) / 64), reach(size * ((size + 63) / 64), 0),
+  dirty(false) {}
+
+  ~ReachabilityIndex() {}
+
+  // true if adding the edge from -> to would create a feedback loop
+  bool willLoop(const std::vector<bool>& connections,
+                unsigned int from, unsigned int to) {
+    if (dirty) {
+      rebuild(connections);
+    }
+
+    return from == to || test(to, from);
+  }
+
+  // to be called after the edge from -> to has been added
+  void insert(unsigned int from, unsigned int to) {
+    if (dirty) {
+      return;
+    }
+
+    // everything reaching from (and from itself) now reaches to and beyond
+    uint64_t* rt = row(to);
+
+    for (unsigned int u = 0; u < n; ++u) {
+      if (u == from || test(u, from)) {
+        uint64_t* ru = row(u);
+        for (unsigned int w = 0; w < words; ++w) { ru[w] |= rt[w]; }
+        set(u, to);
+      }
+    }
+  }
+
+  // to be called after an edge has been removed or after the connections
+  // have been replaced as a whole
+  void invalidate() {
+    dirty = true;
+  }
+
+  void clear() {
+    std::fill(reach.begin(), reach.end(), 0);
+    dirty = false;
+  }
+};
+
+// Kahn's topological sort of the sends graph, true if it has no cycle
+static bool isAcyclic(const std::vector<bool>& connections, unsigned int n) {
+  std::vector<unsigned int> indegrees(n, 0);
+  std::vector<unsigned int> ready;
+  unsigned int sorted = 0;
+
+  for (unsigned int to = 0; to < n; ++to) {
+    for (unsigned int from = 0; from < n; ++from) {
+      if (connections[from + to * n]) { indegrees[to]++; }
+    }
+  }
+
+  for (unsigned int u = 0; u < n; ++u) {
+    if (indegrees[u] == 0) { ready.push_back(u); }
+  }
+
+  while (!ready.empty()) {
+    unsigned int u = ready.back();
+    ready.pop_back();
+    sorted++;
+
+    for (unsigned int to = 0; to < n; ++to) {
+      if (connections[u + to * n] && --indegrees[to] == 0) {
+        ready.push_back(to);
+      }
+    }
+  }
+
+  return sorted == n;
+}
+
+//----------------------------------------------------------------------------//
+
 typedef struct _routerctrl {
   t_object x_obj;
   unsigned int sends;
@@ -49,28 +187,76 @@ typedef struct _routerctrl {
   unsigned int outputs;
   std::vector<bool> sendsConnections;
   std::vector<bool> allConnections;
+  std::vector<bool> dumpedConnections; // state as last sent to the outlet
+  std::vector<t_atom> outatoms; // reused by serialize and dump matrix
+  ReachabilityIndex *reachability;
+  t_jl_routing_shared *shared; // optional, created with the -name flag
   t_outlet *f_out;
 } t_routerctrl;
 
+// make the current connections visible to the router~ objects bound to us,
+// after they have been replaced as a whole
+void routerctrl_publish(t_routerctrl* x) {
+  if (x->shared != nullptr) {
+    jl_routing_shared_publish(x->shared,
+                              x->sends + x->inputs, x->sends + x->outputs,
+                              x->allConnections);
+  }
+}
+
 void routerctrl_dump_connection(t_routerctrl* x, unsigned int* connection) {
   t_atom outatoms[3];
   SETFLOAT(outatoms, *connection);
   SETFLOAT(outatoms + 1, *(connection + 1));
   SETFLOAT(outatoms + 2, *(connection + 2));
   outlet_list(x->f_out, &s_list, 3, outatoms);
+
+  unsigned int index = connection[0] + connection[1] * (x->sends + x->inputs);
+  x->dumpedConnections[index] = x->allConnections[index];
 }
 
-void routerctrl_dump(t_routerctrl* x) {
+// output all cells, or only those that changed since they were last output
+void routerctrl_dump(t_routerctrl* x, bool changedOnly = false) {
   t_atom outatoms[3];
+  unsigned int index;
 
   for (auto i = 0; i < x->sends + x->inputs; ++i) {
     SETFLOAT(outatoms, i);
     for (auto j = 0; j < x->sends + x->outputs; ++j) {
+      index = i + j * (x->sends + x->inputs);
+
+      if (changedOnly && x->allConnections[index] == x->dumpedConnections[index]) {
+        continue;
+      }
+
       SETFLOAT(outatoms + 1, j);
-      SETFLOAT(outatoms + 2, x->allConnections[i + j * (x->sends + x->inputs)] ? 1 : 0);
+      SETFLOAT(outatoms + 2, x->allConnections[index] ? 1 : 0);
       outlet_list(x->f_out, &s_list, 3, outatoms);
     }
   }
+
+  x->dumpedConnections = x->allConnections;
+}
+
+// output the whole matrix as a single "matrix values..." message, values being
+// ordered like in serialize (index = row + column * rows), which is also what
+// the matrix message of a router~ of the same size expects
+void routerctrl_dump_matrix(t_routerctrl* x) {
+  unsigned int size = x->allConnections.size();
+  x->outatoms.resize(size);
+
+  for (auto i = 0; i < size; ++i) {
+    SETFLOAT(x->outatoms.data() + i, x->allConnections[i] ? 1 : 0);
+  }
+
+  outlet_anything(
+    x->f_out,
+    gensym("matrix"),
+    x->outatoms.size(),
+    x->outatoms.data()
+  );
+
+  x->dumpedConnections = x->allConnections;
 }
 
 void routerctrl_list(t_routerctrl* x, t_symbol* s, int argc, t_atom* argv, bool dump = true) {
@@ -99,16 +285,17 @@ void routerctrl_list(t_routerctrl* x, t_symbol* s, int argc, t_atom* argv, bool
       unsigned int sendsIndex = connection[0] + connection[1] * x->sends;
 
       if (connection[2] != 0) {
-        x->sendsConnections[sendsIndex] = !squareMatrixWillLoop(
-          x->sendsConnections,
-          x->sends,
-          connection[0],
-          connection[1]
-        );
+        if (!x->sendsConnections[sendsIndex] &&
+            !x->reachability->willLoop(x->sendsConnections,
+                                       connection[0], connection[1])) {
+          x->sendsConnections[sendsIndex] = true;
+          x->reachability->insert(connection[0], connection[1]);
+        }
 
         connection[2] = x->sendsConnections[sendsIndex] ? 1 : 0;
-      } else {
+      } else if (x->sendsConnections[sendsIndex]) {
         x->sendsConnections[sendsIndex] = false;
+        x->reachability->invalidate();
       }
 
       x->allConnections[allIndex] = x->sendsConnections[sendsIndex];
@@ -116,56 +303,140 @@ void routerctrl_list(t_routerctrl* x, t_symbol* s, int argc, t_atom* argv, bool
       x->allConnections[allIndex] = connection[2] != 0;
     }
 
+    if (x->shared != nullptr) {
+      jl_routing_shared_publish_cell(x->shared, allIndex,
+                                     x->allConnections[allIndex]);
+    }
+
     if (dump) {
       routerctrl_dump_connection(x, connection);
     }
   }
 }
 
+// Restore the whole matrix at once from a list of cell values. The sends
+// graph is validated with a single topological sort, and only if it has cycles
+// are the offending edges trimmed, in one pass and in the order a cell by cell
+// replay would have met them.
+void routerctrl_restore(t_routerctrl* x, const std::vector<bool>& cells) {
+  unsigned int rows = x->sends + x->inputs;
+  std::vector<bool> sends(x->sends * x->sends, false);
+
+  x->allConnections = cells;
+
+  for (auto i = 0; i < x->sends; ++i) {
+    for (auto j = 0; j < x->sends; ++j) {
+      sends[i + j * x->sends] = x->allConnections[i + j * rows];
+    }
+  }
+
+  if (!isAcyclic(sends, x->sends)) {
+    ReachabilityIndex trimmed(x->sends);
+    std::vector<bool> kept(x->sends * x->sends, false);
+
+    for (auto i = 0; i < x->sends; ++i) {
+      for (auto j = 0; j < x->sends; ++j) {
+        if (sends[i + j * x->sends] && !trimmed.willLoop(kept, i, j)) {
+          kept[i + j * x->sends] = true;
+          trimmed.insert(i, j);
+        }
+
+        x->allConnections[i + j * rows] = kept[i + j * x->sends];
+      }
+    }
+
+    sends.swap(kept);
+  }
+
+  x->sendsConnections.swap(sends);
+  x->reachability->invalidate();
+  routerctrl_publish(x);
+}
+
+// output the list of all connection values line by line, either one per atom
+// or packed as JL_ROUTERCTRL_PACKED_BITS bits per atom (preceded by "packed")
+void routerctrl_serialize(t_routerctrl* x, bool packed) {
+  unsigned int size = x->allConnections.size();
+
+  if (!packed) {
+    x->outatoms.resize(size);
+
+    for (auto i = 0; i < size; ++i) {
+      SETFLOAT(x->outatoms.data() + i, x->allConnections[i] ? 1 : 0);
+    }
+  } else {
+    unsigned int nbWords = (size + JL_ROUTERCTRL_PACKED_BITS - 1) / JL_ROUTERCTRL_PACKED_BITS;
+    x->outatoms.resize(nbWords + 1);
+    SETSYMBOL(x->outatoms.data(), gensym("packed"));
+
+    for (auto w = 0; w < nbWords; ++w) {
+      unsigned long word = 0;
+
+      for (auto b = 0; b < JL_ROUTERCTRL_PACKED_BITS; ++b) {
+        unsigned int i = w * JL_ROUTERCTRL_PACKED_BITS + b;
+
+        if (i < size && x->allConnections[i]) {
+          word |= 1ul << b;
+        }
+      }
+
+      SETFLOAT(x->outatoms.data() + w + 1, static_cast<t_float>(word));
+    }
+  }
+
+  outlet_anything(
+    x->f_out,
+    gensym("serialize"),
+    x->outatoms.size(),
+    x->outatoms.data()
+  );
+}
+
 void routerctrl_anything(t_routerctrl* x, t_symbol* s, int argc, t_atom* argv) {
   // post("message input");
   if (s == gensym("clear")) {
     std::fill(x->sendsConnections.begin(), x->sendsConnections.end(), false);
     std::fill(x->allConnections.begin(), x->allConnections.end(), false);
-    routerctrl_dump(x);
+    x->reachability->clear();
+    routerctrl_publish(x);
+    routerctrl_dump(x, true);
   } else if (s == gensym("dump")) {
-    routerctrl_dump(x);
+    t_symbol *mode = argc > 0 ? atom_getsymbol(argv) : nullptr;
+
+    if (mode == gensym("changed")) {
+      routerctrl_dump(x, true);
+    } else if (mode == gensym("matrix")) {
+      routerctrl_dump_matrix(x);
+    } else {
+      routerctrl_dump(x);
+    }
   } else if (s == gensym("set")) {
     // todo
   } else if (s == gensym("serialize")) {
-    // create the list of all connection values line by line
-    unsigned int index;
-    t_atom outatoms[x->allConnections.size() + 1];
-
-    for (auto i = 0; i < x->sends + x->inputs; ++i) {
-      for (auto j = 0; j < x->sends + x->outputs; ++j) {
-        index = i + j * (x->sends + x->inputs);
-        SETFLOAT(outatoms + index, x->allConnections[index] ? 1 : 0);
-      }
-    }
-
-    outlet_anything(
-      x->f_out,
-      gensym("serialize"),
-      x->allConnections.size(),
-      (t_atom *)(&outatoms)
-    );
+    routerctrl_serialize(x, argc > 0 && atom_getsymbol(argv) == gensym("packed"));
   } else if (s == gensym("deserialize")) {
     // restore from a previously serialized list
-    if (argc == x->allConnections.size()) {
-      unsigned int index;
-      t_atom outatoms[3];
-
-      for (auto i = 0; i < x->sends + x->inputs; ++i) {
-        SETFLOAT(outatoms, i);
-
-        for (auto j = 0; j < x->sends + x->outputs; ++j) {
-          index = i + j * (x->sends + x->inputs);
-          SETFLOAT(outatoms + 1, j);
-          SETFLOAT(outatoms + 2, atom_getfloat(argv + index));
-          routerctrl_list(x, gensym("list"), 3, outatoms, false);
+    unsigned int size = x->allConnections.size();
+    unsigned int nbWords = (size + JL_ROUTERCTRL_PACKED_BITS - 1) / JL_ROUTERCTRL_PACKED_BITS;
+    std::vector<bool> cells(size, false);
+
+    if (argc > 0 && atom_getsymbol(argv) == gensym("packed")) {
+      if (argc - 1 == nbWords) {
+        for (auto i = 0; i < size; ++i) {
+          auto word = static_cast<unsigned long>(
+            atom_getfloat(argv + 1 + i / JL_ROUTERCTRL_PACKED_BITS)
+          );
+          cells[i] = (word >> (i % JL_ROUTERCTRL_PACKED_BITS)) & 1;
         }
+
+        routerctrl_restore(x, cells);
+      }
+    } else if (argc == size) {
+      for (auto i = 0; i < size; ++i) {
+        cells[i] = atom_getfloat(argv + i) != 0;
       }
+
+      routerctrl_restore(x, cells);
     }
   }
 }
@@ -181,6 +452,28 @@ void *routerctrl_new(t_symbol *s, int argc, t_atom *argv) {
 
   x->sendsConnections.resize(x->sends * x->sends, false);
   x->allConnections.resize((x->sends + x->inputs) * (x->sends + x->outputs), false);
+  x->dumpedConnections.resize(x->allConnections.size(), false);
+  x->reachability = new ReachabilityIndex(x->sends);
+  x->shared = nullptr;
+
+  // optional flags
+  for (auto i = 3; i < argc; ++i) {
+    if (atom_getsymbol(argv + i) == gensym("-name") && i + 1 < argc) {
+      t_symbol *name = atom_getsymbol(argv + ++i);
+      x->shared = jl_routing_shared_acquire(name);
+
+      if (x->shared == nullptr) {
+        pd_error(x, "routerctrl: name %s is already in use", name->s_name);
+      } else if (x->shared->has_writer) {
+        pd_error(x, "routerctrl: another routerctrl is named %s", name->s_name);
+        jl_routing_shared_release(x->shared);
+        x->shared = nullptr;
+      } else {
+        x->shared->has_writer = true;
+        routerctrl_publish(x);
+      }
+    }
+  }
 
   x->f_out = outlet_new(&x->x_obj, &s_anything);
 
@@ -188,7 +481,13 @@ void *routerctrl_new(t_symbol *s, int argc, t_atom *argv) {
 }
 
 void routerctrl_free(t_routerctrl *x) {
-  // delete x->map;
+  if (x->shared != nullptr) {
+    // the router~ objects still bound keep the last published connections
+    x->shared->has_writer = false;
+    jl_routing_shared_release(x->shared);
+  }
+
+  delete x->reachability;
 }
 
 extern "C" {
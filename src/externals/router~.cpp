@@ -36,13 +36,33 @@
  */
 
 #include <vector>
+#include <algorithm>
 #include <cstdlib>
 #include <ctime>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
 #include "m_pd.h"
-#include "../dependencies/cpp-jl/src/dsp/utilities/Ramp.h"
+#include "../common/BlockRamp.h"
+#include "../common/MixKernels.h"
+#include "../common/WorkerPool.h"
+#include "../common/ScratchArena.h"
+#include "../common/RoutingShared.h"
+
+// in samples, 16 floats make a 64 bytes cache line
+#define JL_ROUTER_ALIGNMENT 16
 
 
 static t_class *router_tilde_class;
+static t_mix_kernels router_tilde_kernels = jl_mix_kernels_scalar;
+
+// signal_setmultiout only exists from pd 0.54, so rather than linking against
+// it (which would prevent loading in older versions) we look it up at setup
+// time. The class is only made multichannel, and -mc only accepted, if found
+typedef void (*t_router_tilde_setmultiout)(t_signal **sig, int nchans);
+static t_router_tilde_setmultiout router_tilde_setmultiout = nullptr;
 
 typedef struct _router_tilde {
   t_object x_obj;
@@ -57,6 +77,10 @@ typedef struct _router_tilde {
   unsigned int nb_s_outlets;
   unsigned int nb_s_xlets;
 
+  // all inputs in one multichannel inlet and all outputs in one multichannel
+  // outlet (pd >= 0.54, created with the -mc flag)
+  bool multichannel;
+
   // in ms
   float fadi;
   float fado;
@@ -67,9 +91,37 @@ typedef struct _router_tilde {
 
   std::vector<t_sample*> s_inputs;
   std::vector<t_sample*> s_outputs;
-  std::vector<jl::Ramp<t_sample, t_sample>> ramps;
-
-  std::vector<std::vector<t_sample>> s_tmp_outputs;
+  std::vector<BlockRamp<t_sample, t_sample>> ramps;
+
+  // indices of the crosspoints that are non-zero or still ramping, sorted so
+  // that they are visited in the same order as the full matrix would be
+  std::vector<unsigned int> active;
+  std::vector<bool> is_active;
+
+  // target gains for the morph message
+  std::vector<t_sample> scene;
+
+  // where each outlet is mixed : directly into the outlet's signal vector, or
+  // into an aligned block of the scratch arena if it aliases some inlet
+  std::vector<t_sample*> s_mix_outputs;
+  std::vector<unsigned int> s_aliased_outlets;
+  unsigned int s_tmp_stride;
+
+  // sized at creation for one block per outlet of max_block_size samples, only
+  // reallocated if the dsp graph gets rebuilt with a bigger block size
+  ScratchArena<t_sample>* arena;
+  int max_block_size;
+
+  // optional, created with the -threads flag
+  WorkerPool* pool;
+  int vec_size; // for the worker threads
+  std::vector<char> part_prune; // one flag per part to avoid sharing a bool
+
+  // optional, created with the -ctrl flag : connections published by a
+  // routerctrl, and the version / state of them we last applied
+  t_jl_routing_shared* ctrl;
+  unsigned long ctrl_version;
+  std::vector<char> ctrl_cells;
 
   std::vector<t_inlet*> s_inlets;
   std::vector<t_outlet*> s_outlets;
@@ -85,17 +137,180 @@ void router_tilde_update_sfades(t_router_tilde* x) {
   x->sfado = x->fado * x->sr * 0.001;
 }
 
+// block size rounded up so that each block starts on an aligned address
+unsigned int router_tilde_stride(unsigned int blockSize) {
+  return (blockSize + JL_ROUTER_ALIGNMENT - 1)
+       / JL_ROUTER_ALIGNMENT * JL_ROUTER_ALIGNMENT;
+}
+
+void router_tilde_activate(t_router_tilde* x, unsigned int rampIndex) {
+  if (!x->is_active[rampIndex]) {
+    // capacity is reserved in the constructor, so this never reallocates
+    x->active.insert(
+      std::lower_bound(x->active.begin(), x->active.end(), rampIndex),
+      rampIndex
+    );
+    x->is_active[rampIndex] = true;
+  }
+}
+
+// drop the crosspoints that reached zero during the last block
+void router_tilde_prune(t_router_tilde* x) {
+  auto end = std::remove_if(x->active.begin(), x->active.end(),
+    [x](unsigned int rampIndex) {
+      const auto& r = x->ramps[rampIndex];
+
+      if (!r.isRamping() && r.getValue() == 0) {
+        x->is_active[rampIndex] = false;
+        return true;
+      }
+
+      return false;
+    }
+  );
+
+  x->active.erase(end, x->active.end());
+}
+
 //--------------------------- OBJECT MESSAGES --------------------------------//
 
+// start ramping crosspoint (i, o) towards v, unless it is already there
+void router_tilde_set(t_router_tilde* x, unsigned int i, unsigned int o,
+                      t_sample v, unsigned long sfade) {
+  if (i >= x->nb_s_inlets || o >= x->nb_s_outlets) {
+    // out of bounds, just ignore
+    return;
+  }
+
+  auto rampIndex = i + o * x->nb_s_inlets;
+  auto& ramp = x->ramps[rampIndex];
+
+  if (!ramp.isRamping() && ramp.getValue() == v && x->is_active[rampIndex] == (v != 0)) {
+    return;
+  }
+
+  ramp.ramp(v, sfade);
+  router_tilde_activate(x, rampIndex);
+}
+
+// fade duration in samples for crosspoint rampIndex to reach v, fadi when
+// going up from where the crosspoint is now (even halfway), fado otherwise
+unsigned long router_tilde_sfade(t_router_tilde* x, unsigned int rampIndex, t_sample v) {
+  return (v > x->ramps[rampIndex].getCurrent()) ? x->sfadi : x->sfado;
+}
+
+// fade the crosspoint (i, o) to gain v with fadi / fado
+void router_tilde_fade_to(t_router_tilde* x, unsigned int i, unsigned int o, t_sample v) {
+  if (i < x->nb_s_inlets && o < x->nb_s_outlets) {
+    router_tilde_set(x, i, o, v, router_tilde_sfade(x, i + o * x->nb_s_inlets, v));
+  }
+}
+
+// apply one routerctrl connection if it differs from the last one applied,
+// leaving the crosspoints set by messages alone
+void router_tilde_ctrl_apply(t_router_tilde* x, unsigned int i, unsigned int o) {
+  if (i < x->nb_s_inlets && o < x->nb_s_outlets) {
+    auto index = i + o * x->nb_s_inlets;
+    char v = jl_routing_shared_get(x->ctrl, i, o);
+
+    if (v != x->ctrl_cells[index]) {
+      x->ctrl_cells[index] = v;
+      router_tilde_fade_to(x, i, o, v ? 1 : 0);
+    }
+  }
+}
+
+// apply the routerctrl connections that changed since the last call, from the
+// change log when we kept up with it, otherwise by rescanning all crosspoints
+void router_tilde_ctrl_sync(t_router_tilde* x) {
+  if (jl_routing_shared_needs_rescan(x->ctrl, x->ctrl_version)) {
+    for (unsigned int o = 0; o < x->nb_s_outlets; ++o) {
+      for (unsigned int i = 0; i < x->nb_s_inlets; ++i) {
+        router_tilde_ctrl_apply(x, i, o);
+      }
+    }
+  } else {
+    unsigned int count;
+    const unsigned int* changes =
+      jl_routing_shared_changes_since(x->ctrl, x->ctrl_version, &count);
+    unsigned int rows = x->ctrl->rows;
+
+    for (unsigned int k = 0; k < count; ++k) {
+      router_tilde_ctrl_apply(x, changes[k] % rows, changes[k] / rows);
+    }
+  }
+
+  x->ctrl_version = x->ctrl->version;
+}
+
+// i o gain [fade time (ms)], a fade time only applies to this change
 void router_tilde_list(t_router_tilde* x, t_symbol* s, int argc, t_atom* argv) {
   if (argc > 2) {
     auto i = static_cast<unsigned int>(atom_getfloat(argv));
     auto o = static_cast<unsigned int>(atom_getfloat(argv + 1));
-    t_sample v = (static_cast<unsigned int>(atom_getfloat(argv + 2)) != 0) ? 1 : 0;
-    unsigned long sfade = (v == 1) ? x->sfadi : x->sfado;
+    t_sample v = atom_getfloat(argv + 2);
+
+    if (i >= x->nb_s_inlets || o >= x->nb_s_outlets) {
+      // out of bounds, just ignore
+      return;
+    }
+
+    if (argc > 3) {
+      float ms = std::max(atom_getfloat(argv + 3), 0.f);
+      router_tilde_set(x, i, o, v, static_cast<unsigned long>(ms * x->sr * 0.001));
+    } else {
+      router_tilde_fade_to(x, i, o, v);
+    }
+  }
+}
+
+// set the whole matrix from a list of nb_s_inlets * nb_s_outlets values,
+// ordered like the crosspoints (inlet index varying fastest)
+void router_tilde_matrix(t_router_tilde* x, int argc, t_atom* argv) {
+  unsigned int size = x->nb_s_inlets * x->nb_s_outlets;
+
+  if (argc != static_cast<int>(size)) {
+    pd_error(x, "router~: matrix expects %u values", size);
+    return;
+  }
+
+  for (unsigned int o = 0; o < x->nb_s_outlets; ++o) {
+    for (unsigned int i = 0; i < x->nb_s_inlets; ++i) {
+      router_tilde_fade_to(x, i, o, atom_getfloat(argv + i + o * x->nb_s_inlets));
+    }
+  }
+}
 
-    auto rampIndex = i + o * x->nb_s_inlets;
-    x->ramps[rampIndex].ramp(v, sfade);
+// set a sparse subset of the matrix from a list of "i o v" triplets
+void router_tilde_cells(t_router_tilde* x, int argc, t_atom* argv) {
+  for (auto k = 0; k + 2 < argc; k += 3) {
+    auto i = static_cast<unsigned int>(atom_getfloat(argv + k));
+    auto o = static_cast<unsigned int>(atom_getfloat(argv + k + 1));
+    router_tilde_fade_to(x, i, o, atom_getfloat(argv + k + 2));
+  }
+}
+
+// store a full matrix (same layout as the matrix message) to morph to later
+void router_tilde_scene(t_router_tilde* x, int argc, t_atom* argv) {
+  if (argc != static_cast<int>(x->scene.size())) {
+    pd_error(x, "router~: scene expects %u values",
+             static_cast<unsigned int>(x->scene.size()));
+    return;
+  }
+
+  for (auto k = 0; k < argc; ++k) {
+    x->scene[k] = atom_getfloat(argv + k);
+  }
+}
+
+// crossfade every crosspoint from its current gain to the stored scene
+void router_tilde_morph(t_router_tilde* x, t_float ms) {
+  unsigned long sfade = static_cast<unsigned long>(std::max(ms, 0.f) * x->sr * 0.001);
+
+  for (unsigned int o = 0; o < x->nb_s_outlets; ++o) {
+    for (unsigned int i = 0; i < x->nb_s_inlets; ++i) {
+      router_tilde_set(x, i, o, x->scene[i + o * x->nb_s_inlets], sfade);
+    }
   }
 }
 
@@ -110,54 +325,192 @@ void router_tilde_anything(t_router_tilde* x, t_symbol* s, int argc, t_atom* arg
     } else if (s == gensym("fade")) {
       x->fadi = x->fado = atom_getfloat(argv);
       router_tilde_update_sfades(x);
+    } else if (s == gensym("matrix")) {
+      router_tilde_matrix(x, argc, argv);
+    } else if (s == gensym("cells")) {
+      router_tilde_cells(x, argc, argv);
+    } else if (s == gensym("scene")) {
+      router_tilde_scene(x, argc, argv);
+    } else if (s == gensym("morph")) {
+      router_tilde_morph(x, atom_getfloat(argv));
     }
   }
 }
 
+void router_tilde_info(t_router_tilde* x) {
+  t_atom outv;
+  SETFLOAT(&outv, static_cast<t_float>(x->arena->bytes()));
+  outlet_anything(x->f_out, gensym("scratch"), 1, &outv);
+  SETFLOAT(&outv, static_cast<t_float>(x->max_block_size));
+  outlet_anything(x->f_out, gensym("maxblock"), 1, &outv);
+}
+
 //---------------------------- DSP OPERATIONS --------------------------------//
 
+// Mix the active crosspoints of the outlets in [oBegin, oEnd[ into their
+// mix outputs. As the active list is sorted by outlet, these are a
+// contiguous range of it, and each outlet is accumulated in the same order
+// whatever the number of parts.
+void router_tilde_mix(t_router_tilde* x, int vecSize,
+                      unsigned int oBegin, unsigned int oEnd, char& prune) {
+  if (oBegin >= oEnd) {
+    return;
+  }
+
+  for (auto i = oBegin; i < oEnd; ++i) {
+    std::fill(x->s_mix_outputs[i], x->s_mix_outputs[i] + vecSize, 0.0f);
+  }
+
+  auto first = std::lower_bound(x->active.begin(), x->active.end(),
+                                oBegin * x->nb_s_inlets);
+  auto last = std::lower_bound(first, x->active.end(),
+                               oEnd * x->nb_s_inlets);
+
+  for (auto it = first; it != last; ++it) {
+    auto rampIndex = *it;
+    auto j = rampIndex % x->nb_s_inlets;
+    auto i = rampIndex / x->nb_s_inlets;
+    auto& ramp = x->ramps[rampIndex];
+    auto rampBlock = ramp.process(vecSize);
+
+    if (rampBlock != nullptr) {
+      router_tilde_kernels.ramp(x->s_mix_outputs[i], x->s_inputs[j], rampBlock, vecSize);
+    } else if (ramp.getValue() == 1) {
+      router_tilde_kernels.add(x->s_mix_outputs[i], x->s_inputs[j], vecSize);
+    } else if (ramp.getValue() != 0) {
+      router_tilde_kernels.gain(x->s_mix_outputs[i], x->s_inputs[j], ramp.getValue(), vecSize);
+    } else {
+      // constant zero, will be pruned once all parts are done
+      prune = 1;
+    }
+  }
+}
+
+// WorkerPool task, splits the outlets range evenly between the parts
+void router_tilde_mix_part(void* context, unsigned int part, unsigned int nbParts) {
+  t_router_tilde* x = (t_router_tilde*) context;
+  unsigned int oBegin = x->nb_s_outlets * part / nbParts;
+  unsigned int oEnd = x->nb_s_outlets * (part + 1) / nbParts;
+
+  x->part_prune[part] = 0;
+  router_tilde_mix(x, x->vec_size, oBegin, oEnd, x->part_prune[part]);
+}
+
 t_int* router_tilde_perform(t_int *w) {
   t_router_tilde *x = (t_router_tilde *)(w[1]);
   int vecSize = (int)(w[2]); // VECTOR SIZE
 
-  for (unsigned int i = 0; i < x->nb_s_outlets; ++i) {
-    std::fill(x->s_tmp_outputs[i].begin(), x->s_tmp_outputs[i].end(), 0.0f);
-
-    for (unsigned int j = 0; j < x->nb_s_inlets; ++j) {
-      auto rampIndex = j + i * x->nb_s_inlets;
-      auto rampBlock = x->ramps[rampIndex].process(vecSize);
+  if (x->ctrl != nullptr && x->ctrl->version != x->ctrl_version) {
+    router_tilde_ctrl_sync(x);
+  }
 
-      for (auto n = 0; n < vecSize; ++n) {
-        x->s_tmp_outputs[i][n] += x->s_inputs[j][n] * rampBlock[n];
-      }
+  if (x->active.empty()) {
+    // nothing to mix, and no risk to overwrite inlets we still need
+    for (unsigned int i = 0; i < x->nb_s_outlets; ++i) {
+      std::fill(x->s_outputs[i], x->s_outputs[i] + vecSize, 0.0f);
     }
+
+    return (w + 3);
   }
 
-  for (unsigned int i = 0; i < x->nb_s_outlets; ++i) {
-    for (auto n = 0; n < vecSize; ++n) {
-      // this is because we might overwrite inlet values too early if we write
-      // into some outlets before we compute all the outputs in a (tmp) buffer
-      x->s_outputs[i][n] = x->s_tmp_outputs[i][n];
-    }
+  x->vec_size = vecSize;
+
+  if (x->pool != nullptr) {
+    x->pool->run(router_tilde_mix_part, x);
+  } else {
+    router_tilde_mix_part(x, 0, 1);
+  }
+
+  if (std::find(x->part_prune.begin(), x->part_prune.end(), 1) != x->part_prune.end()) {
+    router_tilde_prune(x);
+  }
+
+  for (auto i : x->s_aliased_outlets) {
+    // this is because we might overwrite inlet values too early if we write
+    // into some outlets before we compute all the outputs in a (tmp) buffer
+    std::copy(x->s_mix_outputs[i], x->s_mix_outputs[i] + vecSize, x->s_outputs[i]);
   }
 
-  return (w + x->nb_s_xlets + 3);
+  return (w + 3);
+}
+
+// true if the n samples blocks starting at a and b overlap
+bool router_tilde_overlap(const t_sample* a, const t_sample* b, int n) {
+  return a < b + n && b < a + n;
 }
 
 void router_tilde_dsp(t_router_tilde *x, t_signal **sp) {
   x->sr = sys_getsr();
   router_tilde_update_sfades(x);
 
-  for (auto i = 0; i < x->nb_s_inlets; ++i) {
-    x->s_inputs[i] = sp[i]->s_vec;
+  if (x->nb_s_xlets == 0) {
+    return;
   }
 
-  for (auto i = 0; i < x->nb_s_outlets; ++i) {
-    x->s_outputs[i] = sp[x->nb_s_inlets + i]->s_vec;
-    x->s_tmp_outputs[i] = std::vector<t_sample>(sp[0]->s_n);
+  int n = sp[0]->s_n;
+
+  if (n > x->max_block_size) {
+    x->max_block_size = n;
+    x->arena->reserve((x->nb_s_outlets + 1) * router_tilde_stride(x->max_block_size));
   }
 
-  dsp_add(router_tilde_perform, x->nb_s_xlets + 2, x, sp[0]->s_n);
+  x->s_tmp_stride = router_tilde_stride(n);
+  t_sample* base = x->arena->data();
+
+  // silent block after the tmp blocks, read by the missing input channels
+  t_sample* zeros = base + x->nb_s_outlets * router_tilde_stride(x->max_block_size);
+  std::fill(zeros, zeros + n, 0.0f);
+
+  if (x->multichannel) {
+#ifdef CLASS_MULTICHANNEL
+    // multichannel is only set when router_tilde_setmultiout was found. The
+    // channels of the inlet and outlet are contiguous blocks of n samples
+    unsigned int nchans = static_cast<unsigned int>(sp[0]->s_nchans);
+
+    for (unsigned int i = 0; i < x->nb_s_inlets; ++i) {
+      x->s_inputs[i] = (i < nchans) ? sp[0]->s_vec + i * n : zeros;
+    }
+
+    router_tilde_setmultiout(&sp[1], x->nb_s_outlets);
+
+    for (unsigned int i = 0; i < x->nb_s_outlets; ++i) {
+      x->s_outputs[i] = sp[1]->s_vec + i * n;
+    }
+#endif
+  } else {
+    for (unsigned int i = 0; i < x->nb_s_inlets; ++i) {
+      x->s_inputs[i] = sp[i]->s_vec;
+    }
+
+    for (unsigned int i = 0; i < x->nb_s_outlets; ++i) {
+      if (router_tilde_setmultiout != nullptr) {
+        // the class is multichannel, so we must allocate all our outputs
+        router_tilde_setmultiout(&sp[x->nb_s_inlets + i], 1);
+      }
+
+      x->s_outputs[i] = sp[x->nb_s_inlets + i]->s_vec;
+    }
+  }
+
+  x->s_aliased_outlets.clear();
+
+  for (unsigned int i = 0; i < x->nb_s_outlets; ++i) {
+    for (unsigned int j = 0; j < x->nb_s_inlets; ++j) {
+      if (router_tilde_overlap(x->s_outputs[i], x->s_inputs[j], n)) {
+        x->s_aliased_outlets.push_back(i);
+        break;
+      }
+    }
+  }
+
+  // only the outlets sharing their signal vector with an inlet need a tmp block
+  std::copy(x->s_outputs.begin(), x->s_outputs.end(), x->s_mix_outputs.begin());
+
+  for (unsigned int k = 0; k < x->s_aliased_outlets.size(); ++k) {
+    x->s_mix_outputs[x->s_aliased_outlets[k]] = base + k * x->s_tmp_stride;
+  }
+
+  dsp_add(router_tilde_perform, 2, x, n);
 }
 
 //----------------------- CONSTRUCTOR / DESTRUCTOR ---------------------------//
@@ -169,28 +522,85 @@ void* router_tilde_new(t_symbol* s, int argc, t_atom* argv) {
   x->nb_s_outlets = 0;
   x->nb_s_xlets = 0;
 
+  // so that fade times are right before dsp is turned on
+  x->sr = sys_getsr();
+  router_tilde_update_sfades(x);
+
+  unsigned int nbThreads = 1;
+  int maxBlockSize = sys_getblksize();
+  x->ctrl = nullptr;
+  x->ctrl_version = 0;
+
   if (argc > 1) {
     x->nb_s_inlets = static_cast<unsigned int>(atom_getfloat(argv));
     x->nb_s_outlets = static_cast<unsigned int>(atom_getfloat(argv + 1));
     x->nb_s_xlets = x->nb_s_inlets + x->nb_s_outlets;
   }
 
-  x->s_inputs.resize(x->nb_s_inlets);
-  x->s_inlets.resize(x->nb_s_inlets);
+  // optional flags
+  for (auto i = 2; i < argc; ++i) {
+    if (atom_getsymbol(argv + i) == gensym("-threads") && i + 1 < argc) {
+      auto n = static_cast<int>(atom_getfloat(argv + ++i));
+      nbThreads = n > 1 ? static_cast<unsigned int>(n) : 1;
+    } else if (atom_getsymbol(argv + i) == gensym("-maxblock") && i + 1 < argc) {
+      maxBlockSize = std::max(maxBlockSize, static_cast<int>(atom_getfloat(argv + ++i)));
+    } else if (atom_getsymbol(argv + i) == gensym("-mc")) {
+      if (router_tilde_setmultiout != nullptr) {
+        x->multichannel = true;
+      } else {
+        pd_error(x, "router~: -mc flag needs pd 0.54 or later, ignored");
+      }
+    } else if (atom_getsymbol(argv + i) == gensym("-ctrl") && i + 1 < argc) {
+      t_symbol* name = atom_getsymbol(argv + ++i);
+      x->ctrl = jl_routing_shared_acquire(name);
 
-  for (auto i = 0; i < x->nb_s_inlets; ++i) {
-    x->s_inlets[i] = inlet_new(&x->x_obj, &x->x_obj.ob_pd, &s_signal, &s_signal);
+      if (x->ctrl == nullptr) {
+        pd_error(x, "router~: name %s is already used by something else", name->s_name);
+      }
+    }
   }
 
+  x->s_inputs.resize(x->nb_s_inlets);
   x->s_outputs.resize(x->nb_s_outlets);
-  x->s_outlets.resize(x->nb_s_outlets);
+  x->multichannel = x->multichannel && x->nb_s_inlets > 0 && x->nb_s_outlets > 0;
+
+  if (x->multichannel) {
+    x->nb_s_xlets = 2;
+    x->s_inlets.resize(1);
+    x->s_outlets.resize(1);
+    x->s_inlets[0] = inlet_new(&x->x_obj, &x->x_obj.ob_pd, &s_signal, &s_signal);
+    x->s_outlets[0] = outlet_new(&x->x_obj, &s_signal);
+  } else {
+    x->s_inlets.resize(x->nb_s_inlets);
+    x->s_outlets.resize(x->nb_s_outlets);
+
+    for (auto i = 0; i < x->nb_s_inlets; ++i) {
+      x->s_inlets[i] = inlet_new(&x->x_obj, &x->x_obj.ob_pd, &s_signal, &s_signal);
+    }
 
-  for (auto i = 0; i < x->nb_s_outlets; ++i) {
-    x->s_outlets[i] = outlet_new(&x->x_obj, &s_signal);
+    for (auto i = 0; i < x->nb_s_outlets; ++i) {
+      x->s_outlets[i] = outlet_new(&x->x_obj, &s_signal);
+    }
   }
 
   x->ramps.resize(x->nb_s_inlets * x->nb_s_outlets);
-  x->s_tmp_outputs.resize(x->nb_s_outlets);
+  x->is_active.resize(x->nb_s_inlets * x->nb_s_outlets, false);
+  x->scene.resize(x->nb_s_inlets * x->nb_s_outlets, 0);
+  x->ctrl_cells.resize(x->nb_s_inlets * x->nb_s_outlets, 0);
+  x->active.reserve(x->nb_s_inlets * x->nb_s_outlets);
+  x->s_mix_outputs.resize(x->nb_s_outlets);
+  x->s_aliased_outlets.reserve(x->nb_s_outlets);
+
+  x->max_block_size = std::max(maxBlockSize, 1);
+  // one tmp block per outlet, plus a silent one
+  x->arena = new ScratchArena<t_sample>(
+    (x->nb_s_outlets + 1) * router_tilde_stride(x->max_block_size)
+  );
+
+  // no need for more parts than outlets
+  nbThreads = std::max(1u, std::min(nbThreads, x->nb_s_outlets));
+  x->pool = (nbThreads > 1) ? new WorkerPool(nbThreads) : nullptr;
+  x->part_prune.resize(nbThreads, 0);
 
   x->f_out = outlet_new(&x->x_obj, &s_anything);
 
@@ -198,7 +608,9 @@ void* router_tilde_new(t_symbol* s, int argc, t_atom* argv) {
 }
 
 void router_tilde_free(t_router_tilde* x) {
-  // nothing to free for now
+  jl_routing_shared_release(x->ctrl);
+  delete x->pool;
+  delete x->arena;
 }
 
 //============================ SETUP FUNCTION ================================//
@@ -211,19 +623,45 @@ extern "C" {
  */
 void router_tilde_setup(void) {
 
+  int flags = CLASS_DEFAULT;
+
+#ifdef CLASS_MULTICHANNEL
+  int major, minor, bugfix;
+  sys_getversion(&major, &minor, &bugfix);
+
+  if (major > 0 || minor >= 54) {
+#ifdef _WIN32
+    router_tilde_setmultiout = (t_router_tilde_setmultiout)(void *)GetProcAddress(
+      GetModuleHandleA("pd.dll"), "signal_setmultiout"
+    );
+#else
+    router_tilde_setmultiout = (t_router_tilde_setmultiout)dlsym(
+      RTLD_DEFAULT, "signal_setmultiout"
+    );
+#endif
+  }
+
+  if (router_tilde_setmultiout != nullptr) {
+    flags |= CLASS_MULTICHANNEL;
+  }
+#endif
+
   router_tilde_class = class_new(
     gensym("router~"),              /* the object's name is "router~" */
     (t_newmethod)router_tilde_new,  /* the object's constructor */
     (t_method)router_tilde_free,    /* the object's destructor */
     sizeof(t_router_tilde),         /* the size of the data-space */
-    CLASS_DEFAULT,                  /* a normal pd object */
+    flags,                          /* a (multichannel) pd object */
     A_GIMME,                        /* creation arg(s) type(s) */
     0                               /* end creation args */
   );
 
+  router_tilde_kernels = jl_mix_kernels_select();
+
   class_addlist(router_tilde_class, router_tilde_list);
   class_addanything(router_tilde_class, router_tilde_anything);
   class_addmethod(router_tilde_class, (t_method)router_tilde_dsp, gensym("dsp"), A_NULL);
+  class_addmethod(router_tilde_class, (t_method)router_tilde_info, gensym("info"), A_NULL);
 }
 
 }; /* end extern "C" */
@@ -37,6 +37,7 @@
 
 #include "m_pd.h"
 #include "../dependencies/cpp-jl/src/dsp/effects/dynamics/Compress.h"
+#include "../common/BlockRamp.h"
 
 class PdSideChain;
 
@@ -69,10 +70,10 @@ private:
 
   jl::LogDomainSideChain sc;
 
-  jl::Ramp<float, jl::sample> rMakeUp;
-  jl::Ramp<float, jl::sample> rThreshold;
-  jl::Ramp<float, jl::sample> rRatio;
-  jl::Ramp<float, jl::sample> rKnee;
+  BlockRamp<float, jl::sample> rMakeUp;
+  BlockRamp<float, jl::sample> rThreshold;
+  BlockRamp<float, jl::sample> rRatio;
+  BlockRamp<float, jl::sample> rKnee;
 
   float samplingRate;
   float rampDuration;
@@ -134,10 +135,29 @@ public:
     jl::sample *r = rRatio.process(blockSize);
     jl::sample *k = rKnee.process(blockSize);
 
+    // null blocks are constant, use the ramps target values instead
+    if (m == nullptr && t == nullptr && r == nullptr && k == nullptr) {
+      jl::sample mv = rMakeUp.getValue();
+      jl::sample tv = rThreshold.getValue();
+      jl::sample rv = rRatio.getValue();
+      jl::sample kv = rKnee.getValue();
+
+      for (unsigned int i = 0; i < blockSize; ++i) {
+        out[i] = sc.process(in[i], mv, tv, rv, kv);
+      }
+
+      return;
+    }
+
     for (unsigned int i = 0; i < blockSize; ++i) {
       // jl::sample g = sc.process(static_cast<jl::sample>(in[i]), m[i], t[i], r[i], k[i]);
       // out[i] = static_cast<float>(g);
-      out[i] = sc.process(in[i], m[i], t[i], r[i], k[i]);
+      out[i] = sc.process(in[i],
+        m ? m[i] : rMakeUp.getValue(),
+        t ? t[i] : rThreshold.getValue(),
+        r ? r[i] : rRatio.getValue(),
+        k ? k[i] : rKnee.getValue()
+      );
     }
   }
 };
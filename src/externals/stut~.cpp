@@ -35,8 +35,10 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
 #include "m_pd.h"
 #include "../dependencies/cpp-jl/src/dsp/effects/temporal/Stut.h"
+#include "../common/TriggerQueue.h"
 
 #define JL_STUT_DEFAULT_BUFFER_DURATION 1000
 
@@ -49,6 +51,12 @@ typedef struct _stut_tilde {
   t_sample x_f; // this is used in setup function
 
   PdStut *stutter;
+
+  // starts scheduled with the start message, in ms since reference
+  TriggerQueue *starts;
+  double reference;
+  double ms_per_sample;
+
   t_outlet *x_out;
   t_outlet *f_out;
 } t_stut_tilde;
@@ -80,7 +88,13 @@ void stut_tilde_bang(t_stut_tilde *x) {
   x->stutter->start();
 }
 
+// start <delay (ms)> : like bang, at the exact sample
+void stut_tilde_start(t_stut_tilde *x, t_floatarg f) {
+  x->starts->add(clock_gettimesince(x->reference) + std::max(static_cast<float>(f), 0.f));
+}
+
 void stut_tilde_stop(t_stut_tilde *x) {
+  x->starts->clear();
   x->stutter->stop();
 }
 
@@ -130,17 +144,27 @@ t_int *stut_tilde_perform(t_int *w) {
   t_sample *out = (t_sample *)(w[3]);
   int n = (int)(w[4]);
 
-  jl::sample **ins = (jl::sample **)(&in);
-  jl::sample **outs = (jl::sample **)(&out);
+  // this block spans the last n samples before now, as in vline~
+  double start = clock_gettimesince(x->reference) - n * x->ms_per_sample;
 
-  x->stutter->process(ins, outs, n);
+  // the stutter is started between two segments of the block
+  x->starts->run(start, x->ms_per_sample, n,
+    [x, in, out](int offset, int length) {
+      jl::sample *segmentIn = in + offset;
+      jl::sample *segmentOut = out + offset;
+      x->stutter->process(&segmentIn, &segmentOut, length);
+    },
+    [x]() { x->stutter->start(); }
+  );
 
   return (w + 5);
 }
 
 
 void stut_tilde_dsp(t_stut_tilde *x, t_signal **sp) {
-  stut_tilde_setsr(x, sys_getsr());
+  // the local rate, which differs from sys_getsr in a resampled subpatch
+  stut_tilde_setsr(x, sp[0]->s_sr);
+  x->ms_per_sample = 1000. / sp[0]->s_sr;
 
   dsp_add(stut_tilde_perform, 4, x,
           sp[0]->s_vec, sp[1]->s_vec, sp[0]->s_n);
@@ -166,6 +190,10 @@ void *stut_tilde_new(t_symbol *s, int argc, t_atom *argv) {
 
   stut_tilde_setsr(x, sys_getsr());
 
+  x->starts = new TriggerQueue();
+  x->reference = clock_getlogicaltime();
+  x->ms_per_sample = 1000. / sys_getsr();
+
   x->x_out = outlet_new(&x->x_obj, &s_signal);
   x->f_out = outlet_new(&x->x_obj, &s_float);
 
@@ -174,6 +202,7 @@ void *stut_tilde_new(t_symbol *s, int argc, t_atom *argv) {
 
 void stut_tilde_free(t_stut_tilde *x) {
   delete x->stutter;
+  delete x->starts;
   outlet_free(x->x_out);
   outlet_free(x->f_out);
 }
@@ -193,6 +222,7 @@ void stut_tilde_setup(void) {
 
   class_addbang(stut_tilde_class, stut_tilde_bang);
   class_addmethod(stut_tilde_class, (t_method)stut_tilde_dsp, gensym("dsp"), A_NULL);
+  class_addmethod(stut_tilde_class, (t_method)stut_tilde_start, gensym("start"), A_DEFFLOAT, 0);
   class_addmethod(stut_tilde_class, (t_method)stut_tilde_stop, gensym("stop"), A_NULL);
   class_addmethod(stut_tilde_class, (t_method)stut_tilde_slice_duration, gensym("duration"), A_DEFFLOAT, 0);
   class_addmethod(stut_tilde_class, (t_method)stut_tilde_slices, gensym("slices"), A_DEFFLOAT, 0);
@@ -0,0 +1,384 @@
+/**
+ * @file routerctrl-stress.cpp
+ * @brief drives routerctrl with randomized list / clear / serialize /
+ * deserialize sequences, checks its state against a naive reference model
+ * after every operation, and reports the time per operation.
+ *
+ * usage : routerctrl-stress [-o results.csv] [-seed n] [-quick]
+ *
+ * The reference rejects a sends connection if a depth-first search finds a
+ * path back from its destination to its source, and replays deserialized
+ * matrices cell by cell, so it is slow but obviously right. Only the calls to
+ * routerctrl are timed. Serialized lists are passed through "%g" text
+ * formatting before being deserialized, as they would be when saved in a
+ * patch or a [text]. Exits with status 1 at the first mismatch.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include "../src/externals/routerctrl.cpp"
+#include "pd_stub.h"
+
+//----------------------------- REFERENCE MODEL ------------------------------//
+
+struct Reference {
+  unsigned int sends;
+  unsigned int rows;
+  unsigned int columns;
+  std::vector<bool> cells; // same layout as allConnections
+
+  Reference(unsigned int s, unsigned int inputs, unsigned int outputs) :
+  sends(s), rows(s + inputs), columns(s + outputs), cells(rows * columns, false) {}
+
+  bool edge(unsigned int from, unsigned int to) const {
+    return cells[from + to * rows];
+  }
+
+  bool reaches(unsigned int from, unsigned int to) const {
+    std::vector<bool> seen(sends, false);
+    std::vector<unsigned int> stack(1, from);
+    seen[from] = true;
+
+    while (!stack.empty()) {
+      unsigned int u = stack.back();
+      stack.pop_back();
+
+      if (u == to) {
+        return true;
+      }
+
+      for (unsigned int v = 0; v < sends; ++v) {
+        if (edge(u, v) && !seen[v]) {
+          seen[v] = true;
+          stack.push_back(v);
+        }
+      }
+    }
+
+    return false;
+  }
+
+  void list(unsigned int i, unsigned int j, bool v) {
+    if (i >= rows || j >= columns) {
+      return;
+    }
+
+    if (i < sends && j < sends && v && !edge(i, j)) {
+      v = (i != j) && !reaches(j, i);
+    }
+
+    cells[i + j * rows] = v;
+  }
+
+  void clear() {
+    std::fill(cells.begin(), cells.end(), false);
+  }
+
+  void deserialize(const std::vector<bool>& values) {
+    clear();
+
+    for (unsigned int i = 0; i < rows; ++i) {
+      for (unsigned int j = 0; j < columns; ++j) {
+        list(i, j, values[i + j * rows]);
+      }
+    }
+  }
+
+  bool acyclic() const {
+    // 0 = unvisited, 1 = on the current path, 2 = done
+    std::vector<char> state(sends, 0);
+
+    for (unsigned int root = 0; root < sends; ++root) {
+      if (state[root] != 0) {
+        continue;
+      }
+
+      std::vector<std::pair<unsigned int, unsigned int>> stack(1, { root, 0 });
+      state[root] = 1;
+
+      while (!stack.empty()) {
+        auto& top = stack.back();
+
+        if (top.second == sends) {
+          state[top.first] = 2;
+          stack.pop_back();
+          continue;
+        }
+
+        unsigned int v = top.second++;
+
+        if (edge(top.first, v)) {
+          if (state[v] == 1) {
+            return false;
+          }
+
+          if (state[v] == 0) {
+            state[v] = 1;
+            stack.push_back({ v, 0 });
+          }
+        }
+      }
+    }
+
+    return true;
+  }
+};
+
+//--------------------------------- DRIVER -----------------------------------//
+
+enum Operation { ListOn, ListOff, Clear, Serialize, Deserialize, NbOperations };
+
+static const char* operationNames[NbOperations] = {
+  "list on", "list off", "clear", "serialize", "deserialize"
+};
+
+struct Timing {
+  unsigned long count = 0;
+  double ns = 0;
+};
+
+static bool check(t_routerctrl* x, const Reference& ref, unsigned long step,
+                  const char* operation) {
+  const char* error = nullptr;
+
+  if (x->allConnections != ref.cells) {
+    error = "connections differ from the reference";
+  } else if (!ref.acyclic()) {
+    error = "sends graph has a cycle";
+  } else {
+    for (unsigned int i = 0; i < ref.sends && error == nullptr; ++i) {
+      for (unsigned int j = 0; j < ref.sends; ++j) {
+        if (x->sendsConnections[i + j * ref.sends] != ref.edge(i, j)) {
+          error = "sends matrix out of sync with the full matrix";
+          break;
+        }
+      }
+    }
+  }
+
+  if (error != nullptr) {
+    std::fprintf(stderr, "%u sends, step %lu (%s) : %s\n",
+                 ref.sends, step, operation, error);
+    return false;
+  }
+
+  return true;
+}
+
+// format float atoms the way pd saves them in patch files and read them back
+static void textRoundTrip(std::vector<t_atom>& atoms) {
+  char buf[32];
+
+  for (auto& a : atoms) {
+    if (a.a_type == A_FLOAT) {
+      std::snprintf(buf, sizeof(buf), "%g", a.a_w.w_float);
+      a.a_w.w_float = static_cast<t_float>(std::strtod(buf, nullptr));
+    }
+  }
+}
+
+// a full matrix gives all-ones words, the largest values a packed list holds
+static bool checkFullMatrix(unsigned int sends) {
+  std::vector<t_atom> args = {
+    pd_stub_float(sends), pd_stub_float(2), pd_stub_float(2)
+  };
+
+  auto x = (t_routerctrl*) pd_stub_new(routerctrl_new, "routerctrl", args);
+  std::fill(x->allConnections.begin(), x->allConnections.end(), true);
+
+  t_atom packed = pd_stub_symbol("packed");
+  routerctrl_anything(x, gensym("serialize"), 1, &packed);
+  pd_stub_messages.clear();
+
+  std::vector<t_atom> serialized = x->outatoms;
+  textRoundTrip(serialized);
+  bool ok = true;
+
+  for (unsigned int k = 1; k < serialized.size(); ++k) {
+    ok = ok && serialized[k].a_w.w_float == x->outatoms[k].a_w.w_float;
+  }
+
+  routerctrl_free(x);
+
+  if (!ok) {
+    std::fprintf(stderr, "%u sends : packed words lost bits in text\n", sends);
+  }
+
+  return ok;
+}
+
+static bool runSize(unsigned int sends, unsigned long nbSteps, std::mt19937& rng,
+                    Timing* timings) {
+  const unsigned int inputs = 2;
+  const unsigned int outputs = 2;
+
+  std::vector<t_atom> args = {
+    pd_stub_float(sends), pd_stub_float(inputs), pd_stub_float(outputs)
+  };
+
+  auto x = (t_routerctrl*) pd_stub_new(routerctrl_new, "routerctrl", args);
+  Reference ref(sends, inputs, outputs);
+  std::vector<bool> values(ref.cells.size());
+  std::vector<t_atom> serialized;
+  bool ok = true;
+
+  for (unsigned long step = 0; step < nbSteps && ok; ++step) {
+    unsigned int dice = rng() % 1000;
+    Operation op = dice < 600 ? ListOn
+                 : dice < 960 ? ListOff
+                 : dice < 965 ? Clear
+                 : dice < 985 ? Serialize
+                 : Deserialize;
+
+    // mostly sends to sends cells, which are the ones that can loop
+    unsigned int i = (rng() % 8 == 0) ? rng() % ref.rows : rng() % sends;
+    unsigned int j = (rng() % 8 == 0) ? rng() % ref.columns : rng() % sends;
+    t_atom l[3] = {
+      pd_stub_float(i), pd_stub_float(j), pd_stub_float(op == ListOn ? 1 : 0)
+    };
+    t_atom packed = pd_stub_symbol("packed");
+    bool usePacked = rng() % 2 == 0;
+
+    if (op == Deserialize) {
+      // either a previous state, or random and most likely cyclic
+      if (!serialized.empty() && rng() % 2 == 0) {
+        routerctrl_anything(x, gensym("serialize"), usePacked ? 1 : 0, &packed);
+        serialized = x->outatoms;
+        textRoundTrip(serialized);
+        std::copy(ref.cells.begin(), ref.cells.end(), values.begin());
+      } else {
+        unsigned int density = 1 + rng() % 50; // in %
+
+        for (unsigned int k = 0; k < values.size(); ++k) {
+          values[k] = rng() % 100 < density;
+        }
+
+        serialized.resize(values.size());
+
+        for (unsigned int k = 0; k < values.size(); ++k) {
+          serialized[k] = pd_stub_float(values[k] ? 1 : 0);
+        }
+      }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    switch (op) {
+      case ListOn:
+      case ListOff:
+        routerctrl_list(x, &s_list, 3, l);
+        break;
+      case Clear:
+        routerctrl_anything(x, gensym("clear"), 0, nullptr);
+        break;
+      case Serialize:
+        routerctrl_anything(x, gensym("serialize"), usePacked ? 1 : 0, &packed);
+        break;
+      case Deserialize:
+        routerctrl_anything(x, gensym("deserialize"),
+                            serialized.size(), serialized.data());
+        break;
+      default:
+        break;
+    }
+
+    auto stop = std::chrono::steady_clock::now();
+    timings[op].count++;
+    timings[op].ns += std::chrono::duration<double, std::nano>(stop - start).count();
+    pd_stub_messages.clear();
+
+    switch (op) {
+      case ListOn:
+      case ListOff:
+        ref.list(i, j, op == ListOn);
+        break;
+      case Clear:
+        ref.clear();
+        break;
+      case Serialize:
+        serialized = x->outatoms;
+        textRoundTrip(serialized);
+        break;
+      case Deserialize:
+        ref.deserialize(values);
+        break;
+      default:
+        break;
+    }
+
+    ok = check(x, ref, step, operationNames[op]);
+  }
+
+  routerctrl_free(x);
+  return ok;
+}
+
+int main(int argc, char** argv) {
+  std::string csvPath;
+  unsigned int seed = 1;
+  bool quick = false;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      csvPath = argv[++i];
+    } else if (std::strcmp(argv[i], "-seed") == 0 && i + 1 < argc) {
+      seed = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "-quick") == 0) {
+      quick = true;
+    }
+  }
+
+  const std::vector<unsigned int> sizes = { 2, 4, 8, 16, 32, 64, 128, 256 };
+  const unsigned long nbSteps = quick ? 2000 : 20000;
+
+  routerctrl_setup();
+
+  FILE* csv = nullptr;
+
+  if (!csvPath.empty()) {
+    csv = std::fopen(csvPath.c_str(), "w");
+
+    if (csv == nullptr) {
+      std::fprintf(stderr, "cannot open %s\n", csvPath.c_str());
+      return 1;
+    }
+
+    std::fprintf(csv, "sends,operation,count,ns_per_operation\n");
+  }
+
+  std::printf("seed : %u, %lu operations per size\n", seed, nbSteps);
+  std::printf("%6s %12s %8s %12s\n", "sends", "operation", "count", "ns/op");
+
+  std::mt19937 rng(seed);
+
+  for (auto sends : sizes) {
+    Timing timings[NbOperations];
+
+    if (!checkFullMatrix(sends) || !runSize(sends, nbSteps, rng, timings)) {
+      return 1;
+    }
+
+    for (unsigned int op = 0; op < NbOperations; ++op) {
+      double nsPerOp = timings[op].count > 0 ? timings[op].ns / timings[op].count : 0;
+
+      std::printf("%6u %12s %8lu %12.0f\n",
+                  sends, operationNames[op], timings[op].count, nsPerOp);
+
+      if (csv != nullptr) {
+        std::fprintf(csv, "%u,%s,%lu,%.1f\n",
+                     sends, operationNames[op], timings[op].count, nsPerOp);
+      }
+    }
+  }
+
+  if (csv != nullptr) {
+    std::fclose(csv);
+  }
+
+  std::printf("all states matched the reference\n");
+  return 0;
+}
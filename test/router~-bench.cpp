@@ -0,0 +1,174 @@
+/**
+ * @file router~-bench.cpp
+ * @brief measures router~ perform cost across matrix sizes, connection
+ * densities, block sizes, and steady vs ramping crosspoints.
+ *
+ * usage : router~-bench [-o results.csv] [-t threads] [-quick]
+ *
+ * The cost is reported in ns per sample per crosspoint (counting all the
+ * crosspoints of the matrix, connected or not), so that a perfectly scaling
+ * implementation gives the same figure whatever the matrix size, and a sparse
+ * matrix shows how much the skipped crosspoints still cost.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "../src/externals/router~.cpp"
+#include "pd_stub.h"
+
+struct BenchConfig {
+  unsigned int size;
+  float density;
+  int blockSize;
+  bool ramping;
+  unsigned int threads;
+};
+
+struct BenchResult {
+  double nsPerBlock;
+  double nsPerSamplePerCrosspoint;
+  unsigned long active;
+};
+
+// deterministic pseudo random choice of the connected crosspoints
+static bool isConnected(unsigned int i, unsigned int o, float density) {
+  unsigned int h = (i * 73856093u) ^ (o * 19349663u);
+  h ^= h >> 13;
+  h *= 0x5bd1e995u;
+  h ^= h >> 15;
+  return (h % 10000) < static_cast<unsigned int>(density * 10000);
+}
+
+static BenchResult runConfig(const BenchConfig& c, unsigned long workload) {
+  std::vector<t_atom> args = {
+    pd_stub_float(c.size), pd_stub_float(c.size),
+    pd_stub_symbol("-threads"), pd_stub_float(c.threads)
+  };
+
+  pd_stub_set_dsp_params(48000, c.blockSize);
+  auto x = (t_router_tilde*) pd_stub_new(router_tilde_new, "router~", args);
+  PdStubSignals signals(2 * c.size, c.blockSize);
+
+  for (unsigned int i = 0; i < c.size; ++i) {
+    for (unsigned int n = 0; n < static_cast<unsigned int>(c.blockSize); ++n) {
+      signals.vec(i)[n] = std::sin(0.001f * n * (i + 1));
+    }
+  }
+
+  pd_stub_dsp_clear();
+  router_tilde_dsp(x, signals.get());
+
+  for (unsigned int i = 0; i < c.size; ++i) {
+    for (unsigned int o = 0; o < c.size; ++o) {
+      if (isConnected(i, o, c.density)) {
+        // a very long fade keeps the crosspoint ramping during the whole run
+        t_atom l[4] = {
+          pd_stub_float(i), pd_stub_float(o), pd_stub_float(1),
+          pd_stub_float(c.ramping ? 1e7 : 0)
+        };
+        router_tilde_list(x, &s_list, 4, l);
+      }
+    }
+  }
+
+  // warm up, this also lets the steady crosspoints reach their target
+  for (unsigned int b = 0; b < 4; ++b) {
+    pd_stub_dsp_tick();
+  }
+
+  unsigned long crosspoints = c.size * c.size;
+  unsigned long blocks = std::max(8ul, workload / (crosspoints * c.blockSize));
+
+  auto start = std::chrono::steady_clock::now();
+
+  for (unsigned long b = 0; b < blocks; ++b) {
+    pd_stub_dsp_tick();
+  }
+
+  auto stop = std::chrono::steady_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+
+  BenchResult r;
+  r.nsPerBlock = ns / blocks;
+  r.nsPerSamplePerCrosspoint = r.nsPerBlock / (c.blockSize * crosspoints);
+  r.active = x->active.size();
+
+  router_tilde_free(x);
+  return r;
+}
+
+int main(int argc, char** argv) {
+  std::string csvPath;
+  unsigned int threads = 1;
+  bool quick = false;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      csvPath = argv[++i];
+    } else if (std::strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+      threads = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "-quick") == 0) {
+      quick = true;
+    }
+  }
+
+  const std::vector<unsigned int> sizes = { 4, 8, 16, 32, 64, 128 };
+  const std::vector<float> densities = { 0.f, 0.05f, 0.5f, 1.f };
+  const std::vector<int> blockSizes = quick
+    ? std::vector<int>{ 64 }
+    : std::vector<int>{ 16, 64, 256, 1024, 2048 };
+  // samples x crosspoints processed per configuration
+  const unsigned long workload = quick ? (1ul << 22) : (1ul << 25);
+
+  router_tilde_setup();
+
+  FILE* csv = nullptr;
+
+  if (!csvPath.empty()) {
+    csv = std::fopen(csvPath.c_str(), "w");
+
+    if (csv == nullptr) {
+      std::fprintf(stderr, "cannot open %s\n", csvPath.c_str());
+      return 1;
+    }
+
+    std::fprintf(csv, "kernels,threads,inlets,outlets,density,block_size,state,"
+                      "active,ns_per_block,ns_per_sample_per_crosspoint\n");
+  }
+
+  std::printf("kernels : %s, threads : %u\n", router_tilde_kernels.name, threads);
+  std::printf("%9s %8s %6s %8s %8s %14s %12s\n",
+              "size", "density", "block", "state", "active", "ns/block", "ns/smp/xpt");
+
+  for (auto ramping : { false, true }) {
+    for (auto size : sizes) {
+      for (auto density : densities) {
+        for (auto blockSize : blockSizes) {
+          BenchConfig c = { size, density, blockSize, ramping, threads };
+          BenchResult r = runConfig(c, workload);
+          const char* state = ramping ? "ramping" : "steady";
+
+          std::printf("%4ux%-4u %7.0f%% %6d %8s %8lu %14.0f %12.4f\n",
+                      size, size, density * 100, blockSize, state, r.active,
+                      r.nsPerBlock, r.nsPerSamplePerCrosspoint);
+
+          if (csv != nullptr) {
+            std::fprintf(csv, "%s,%u,%u,%u,%g,%d,%s,%lu,%.1f,%.6f\n",
+                         router_tilde_kernels.name, threads, size, size,
+                         density, blockSize, state, r.active,
+                         r.nsPerBlock, r.nsPerSamplePerCrosspoint);
+          }
+        }
+      }
+    }
+  }
+
+  if (csv != nullptr) {
+    std::fclose(csv);
+  }
+
+  return 0;
+}
@@ -0,0 +1,230 @@
+/**
+ * @file router~-ctrl-test.cpp
+ * @brief checks router~ -ctrl driven by routerctrl -name : binding next to a
+ * receive of the same name, versions and change log, audio following the
+ * published connections, late readers, writer teardown and name clashes.
+ *
+ * usage : router~-ctrl-test
+ *
+ * Both externals are built in the same program, which is enough to exercise
+ * the shared instance since it is looked up by class name anyway. Exits with
+ * status 1 if any check failed.
+ */
+
+#include <cstdio>
+#include "../src/externals/router~.cpp"
+#include "../src/externals/routerctrl.cpp"
+#include "pd_stub.h"
+
+static const int blockSize = 64;
+static unsigned int failures = 0;
+
+static void expect(bool ok, const char* what) {
+  if (!ok) {
+    std::fprintf(stderr, "failed : %s\n", what);
+    failures++;
+  }
+}
+
+struct Router {
+  t_router_tilde* x;
+  PdStubSignals signals;
+
+  // 2 x 2, no fades, inlet i carries the constant value i + 1
+  Router(const char* ctrl) : signals(4, blockSize) {
+    std::vector<t_atom> args = {
+      pd_stub_float(2), pd_stub_float(2),
+      pd_stub_symbol("-ctrl"), pd_stub_symbol(ctrl)
+    };
+
+    x = (t_router_tilde*) pd_stub_new(router_tilde_new, "router~", args);
+    t_atom zero = pd_stub_float(0);
+    router_tilde_anything(x, gensym("fade"), 1, &zero);
+  }
+
+  ~Router() { router_tilde_free(x); }
+
+  void dsp() { router_tilde_dsp(x, signals.get()); }
+
+  void fillInputs() {
+    for (unsigned int i = 0; i < 2; ++i) {
+      std::fill(signals.vec(i), signals.vec(i) + blockSize, t_sample(i + 1));
+    }
+  }
+
+  t_sample out(unsigned int o) { return signals.vec(2 + o)[blockSize - 1]; }
+
+  // the crosspoints applied from the controller match its connections
+  bool follows(t_routerctrl* c) {
+    for (unsigned int i = 0; i < 2; ++i) {
+      for (unsigned int o = 0; o < 2; ++o) {
+        if ((x->ctrl_cells[i + o * 2] != 0) != c->allConnections[i + o * 2]) {
+          return false;
+        }
+      }
+    }
+
+    return true;
+  }
+};
+
+static t_routerctrl* newCtrl(const char* name) {
+  std::vector<t_atom> args = {
+    pd_stub_float(0), pd_stub_float(2), pd_stub_float(2),
+    pd_stub_symbol("-name"), pd_stub_symbol(name)
+  };
+
+  return (t_routerctrl*) pd_stub_new(routerctrl_new, "routerctrl", args);
+}
+
+static void connect(t_routerctrl* c, unsigned int i, unsigned int o, bool on) {
+  t_atom l[3] = { pd_stub_float(i), pd_stub_float(o), pd_stub_float(on ? 1 : 0) };
+  routerctrl_list(c, &s_list, 3, l);
+}
+
+static void tick(Router* r1, Router* r2 = nullptr) {
+  r1->fillInputs();
+  if (r2 != nullptr) { r2->fillInputs(); }
+  pd_stub_dsp_tick();
+  pd_stub_messages.clear();
+}
+
+int main() {
+  router_tilde_setup();
+  routerctrl_setup();
+  pd_stub_set_dsp_params(48000, blockSize);
+
+  // stands for a [r bus] in the same patch
+  t_class* receiveClass = class_new(gensym("receive"), 0, 0, sizeof(t_pd),
+                                    CLASS_PD, A_NULL);
+  t_pd* receive = pd_new(receiveClass);
+  pd_bind(receive, gensym("bus"));
+
+  //================================ ACQUIRE =================================//
+
+  t_routerctrl* c = newCtrl("bus");
+  Router* r = new Router("bus");
+  expect(c->shared != nullptr, "routerctrl -name bus next to [r bus]");
+  expect(r->x->ctrl != nullptr && r->x->ctrl == c->shared,
+         "router~ -ctrl bus shares the routerctrl instance");
+  expect(gensym("bus")->s_thing == receive, "[r bus] keeps its binding");
+
+  t_jl_routing_shared* shared = c->shared;
+
+  pd_stub_dsp_clear();
+  r->dsp();
+  tick(r);
+  expect(r->x->ctrl_version == shared->version, "router~ catches up on dsp");
+
+  //================================ VERSIONS ================================//
+
+  unsigned long version = shared->version;
+  connect(c, 0, 1, true);
+  expect(shared->version == version + 1, "a change bumps the version once");
+  connect(c, 0, 1, true);
+  expect(shared->version == version + 1, "a repeated value is not logged");
+  expect(!jl_routing_shared_needs_rescan(shared, r->x->ctrl_version),
+         "a reader that kept up reads the log");
+
+  tick(r);
+  expect(r->x->ctrl_version == shared->version, "router~ drains the log");
+  expect(r->out(0) == 0 && r->out(1) == 1, "inlet 0 routed to outlet 1");
+
+  // more changes than cells between two blocks empty the log
+  for (unsigned int k = 0; k < 11; ++k) {
+    connect(c, k % 2, (k / 2) % 2, k % 3 == 0);
+  }
+
+  expect(jl_routing_shared_needs_rescan(shared, r->x->ctrl_version),
+         "a reader left behind by the log rescans");
+  tick(r);
+  expect(r->follows(c), "router~ rescans to the controller state");
+
+  // a whole matrix only logs the cells that differ
+  std::vector<t_atom> cells(4);
+
+  for (unsigned int k = 0; k < 4; ++k) {
+    bool v = c->allConnections[k] != (k == 2);
+    cells[k] = pd_stub_float(v ? 1 : 0);
+  }
+
+  version = shared->version;
+  routerctrl_anything(c, gensym("deserialize"), cells.size(), cells.data());
+  expect(shared->version == version + 1, "deserialize logs one changed cell");
+  tick(r);
+  expect(r->follows(c), "router~ follows deserialize");
+
+  //=============================== LATE READER ==============================//
+
+  Router* late = new Router("bus");
+  pd_stub_dsp_clear();
+  r->dsp();
+  late->dsp();
+  tick(r, late);
+  expect(late->follows(c), "a router~ created later gets the current state");
+
+  //================================ TEARDOWN ================================//
+
+  t_routerctrl* second = newCtrl("bus");
+  expect(second->shared == nullptr, "a second routerctrl -name bus is refused");
+  routerctrl_free(second);
+  expect(shared->has_writer, "refusing the second writer keeps the first");
+
+  routerctrl_anything(c, gensym("clear"), 0, nullptr);
+  connect(c, 1, 0, true);
+  tick(r, late);
+  routerctrl_free(c);
+
+  expect(!shared->has_writer && r->x->ctrl == shared,
+         "router~ keeps the instance when the writer goes");
+  tick(r, late);
+  expect(r->out(0) == 2 && r->out(1) == 0,
+         "router~ keeps the last connections without writer");
+
+  c = newCtrl("bus");
+  expect(c->shared == shared, "a new writer takes over the instance");
+  tick(r, late);
+  expect(r->out(0) == 0 && late->out(0) == 0,
+         "the new writer's empty matrix is applied");
+  routerctrl_free(c);
+
+  //================================= CLASH ==================================//
+
+  t_pd* squatter = pd_new(receiveClass);
+  pd_bind(squatter, gensym(JL_ROUTING_SHARED_PREFIX "clash"));
+
+  Router clash("clash");
+  t_routerctrl* clashCtrl = newCtrl("clash");
+  expect(clash.x->ctrl == nullptr, "router~ refuses a name bound elsewhere");
+  expect(clashCtrl->shared == nullptr, "routerctrl refuses a name bound elsewhere");
+  routerctrl_free(clashCtrl);
+
+  pd_stub_dsp_clear();
+  clash.dsp();
+  tick(&clash);
+  expect(clash.out(0) == 0 && clash.out(1) == 0, "router~ still runs alone");
+
+  pd_unbind(squatter, gensym(JL_ROUTING_SHARED_PREFIX "clash"));
+  pd_free(squatter);
+
+  //================================ RELEASE =================================//
+
+  pd_stub_dsp_clear();
+  delete late;
+  expect(gensym(JL_ROUTING_SHARED_PREFIX "bus")->s_thing == &shared->pd,
+         "the instance lives as long as a reader holds it");
+  delete r;
+  expect(gensym(JL_ROUTING_SHARED_PREFIX "bus")->s_thing == nullptr,
+         "the last reader frees the instance");
+
+  pd_unbind(receive, gensym("bus"));
+  pd_free(receive);
+
+  if (failures > 0) {
+    std::fprintf(stderr, "%u check(s) failed\n", failures);
+    return 1;
+  }
+
+  std::printf("all checks passed\n");
+  return 0;
+}
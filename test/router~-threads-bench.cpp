@@ -0,0 +1,125 @@
+/**
+ * @file router~-threads-bench.cpp
+ * @brief compares single and multithreaded router~ on square matrices of
+ * increasing size, checks that both produce the exact same output and reports
+ * the smallest size from which the threaded mode is faster.
+ *
+ * usage : router~-threads-bench [threads (default 4)] [block size (default 64)]
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include "../src/externals/router~.cpp"
+#include "pd_stub.h"
+
+struct RouterInstance {
+  t_router_tilde* x;
+  PdStubSignals signals;
+
+  RouterInstance(unsigned int size, unsigned int threads, int blockSize) :
+  signals(2 * size, blockSize) {
+    std::vector<t_atom> args = {
+      pd_stub_float(size), pd_stub_float(size),
+      pd_stub_symbol("-threads"), pd_stub_float(threads)
+    };
+
+    x = (t_router_tilde*) pd_stub_new(router_tilde_new, "router~", args);
+
+    // half of the crosspoints connected, always the same ones
+    for (unsigned int i = 0; i < size; ++i) {
+      for (unsigned int o = 0; o < size; ++o) {
+        if (((i * 7919 + o * 104729) >> 3) % 2 == 0) {
+          t_atom l[3] = { pd_stub_float(i), pd_stub_float(o), pd_stub_float(1) };
+          router_tilde_list(x, &s_list, 3, l);
+        }
+      }
+    }
+
+    pd_stub_dsp_clear();
+    router_tilde_dsp(x, signals.get());
+  }
+
+  ~RouterInstance() {
+    router_tilde_free(x);
+  }
+
+  void fillInputs(unsigned int size, int blockSize, unsigned int block) {
+    for (unsigned int j = 0; j < size; ++j) {
+      for (int n = 0; n < blockSize; ++n) {
+        signals.vec(j)[n] = std::sin(0.01f * (block * blockSize + n) * (j + 1));
+      }
+    }
+  }
+};
+
+int main(int argc, char** argv) {
+  unsigned int threads = argc > 1 ? std::atoi(argv[1]) : 4;
+  int blockSize = argc > 2 ? std::atoi(argv[2]) : 64;
+  const unsigned int blocks = 2000;
+  const unsigned int sizes[] = { 4, 8, 16, 24, 32, 48, 64, 96, 128, 192, 256 };
+
+  router_tilde_setup();
+  pd_stub_set_dsp_params(48000, blockSize);
+
+  printf("kernels : %s, threads : %u, block size : %d\n",
+         router_tilde_kernels.name, threads, blockSize);
+  printf("%8s %14s %14s %8s\n", "size", "single (ns)", "threaded (ns)", "ratio");
+
+  unsigned int crossover = 0;
+  bool identical = true;
+
+  for (auto size : sizes) {
+    double ns[2];
+
+    for (unsigned int mode = 0; mode < 2; ++mode) {
+      RouterInstance r(size, mode == 0 ? 1 : threads, blockSize);
+      auto start = std::chrono::steady_clock::now();
+
+      for (unsigned int b = 0; b < blocks; ++b) {
+        r.fillInputs(size, blockSize, b);
+        pd_stub_dsp_tick();
+      }
+
+      auto stop = std::chrono::steady_clock::now();
+      ns[mode] = std::chrono::duration<double, std::nano>(stop - start).count() / blocks;
+    }
+
+    // run both modes side by side to compare their outputs
+    RouterInstance single(size, 1, blockSize);
+    RouterInstance threaded(size, threads, blockSize);
+    t_perfroutine perform = router_tilde_perform;
+
+    for (unsigned int b = 0; b < 64; ++b) {
+      single.fillInputs(size, blockSize, b);
+      threaded.fillInputs(size, blockSize, b);
+      t_int w1[3] = { (t_int) perform, (t_int) single.x, blockSize };
+      t_int w2[3] = { (t_int) perform, (t_int) threaded.x, blockSize };
+      router_tilde_perform(w1);
+      router_tilde_perform(w2);
+
+      for (unsigned int o = 0; o < size; ++o) {
+        if (std::memcmp(single.signals.vec(size + o), threaded.signals.vec(size + o),
+                        blockSize * sizeof(t_sample)) != 0) {
+          identical = false;
+        }
+      }
+    }
+
+    if (crossover == 0 && ns[1] < ns[0]) {
+      crossover = size;
+    }
+
+    printf("%4ux%-4u %14.0f %14.0f %8.2f\n", size, size, ns[0], ns[1], ns[0] / ns[1]);
+  }
+
+  if (crossover > 0) {
+    printf("threaded mode wins from %ux%u\n", crossover, crossover);
+  } else {
+    printf("threaded mode never wins on this machine\n");
+  }
+
+  printf("outputs %s\n", identical ? "bit-identical" : "DIFFER");
+  return identical ? 0 : 1;
+}
@@ -0,0 +1,85 @@
+/**
+ * @file m_pd.h
+ * @brief minimal subset of pure data's API to build and run the externals
+ * headless, for the benchmarks and stress tests in this directory only.
+ *
+ * Only the types and functions actually used by the externals are declared,
+ * and the struct layouts are NOT the real ones : never build an external to be
+ * loaded by pd against this file.
+ */
+
+#ifndef __m_pd_h_
+#define __m_pd_h_
+#include <stddef.h>
+#define PD_MAJOR_VERSION 0
+#define PD_MINOR_VERSION 54
+#define PD_FLOATSIZE 32
+#define EXTERN extern
+typedef long t_int;
+typedef float t_float;
+typedef float t_floatarg;
+typedef float t_sample;
+struct _class; typedef struct _class *t_pd; typedef struct _class t_class;
+typedef struct _symbol { const char *s_name; t_pd *s_thing; struct _symbol *s_next; } t_symbol;
+typedef union word { t_float w_float; t_symbol *w_symbol; int w_index; } t_word;
+typedef enum { A_NULL, A_FLOAT, A_SYMBOL, A_POINTER, A_SEMI, A_COMMA, A_DEFFLOAT, A_DEFSYM, A_DOLLAR, A_DOLLSYM, A_GIMME, A_CANT } t_atomtype;
+typedef struct _atom { t_atomtype a_type; union word a_w; } t_atom;
+typedef struct _outlet t_outlet; typedef struct _inlet t_inlet;
+typedef struct _gobj { t_pd g_pd; struct _gobj *g_next; } t_gobj;
+typedef struct _text { t_gobj te_g; void *te_binbuf; t_outlet *te_outlet; t_inlet *te_inlet; short te_xpix, te_ypix, te_width; unsigned int te_type:2; } t_object;
+#define ob_pd te_g.g_pd
+typedef struct _signal { int s_n; t_sample *s_vec; t_float s_sr; int s_nchans; int s_overlap; int s_refcount; int s_isborrowed; int s_isscalar; void *s_borrowedfrom; struct _signal *s_nextfree; struct _signal *s_nextused; int s_nalloc; } t_signal;
+typedef struct _garray t_garray;
+typedef void (*t_method)(void); typedef void *(*t_newmethod)(void);
+typedef t_int *(*t_perfroutine)(t_int *args);
+extern t_symbol s_signal, s_anything, s_list, s_float, s_bang, s_symbol, s__X;
+extern t_class *garray_class;
+#define CLASS_DEFAULT 0
+#define CLASS_PD 1
+#define CLASS_MULTICHANNEL 256
+#define CLASS_NOINLET 8
+#define SETFLOAT(atom, f) ((atom)->a_type = A_FLOAT, (atom)->a_w.w_float = (f))
+#define SETSYMBOL(atom, s) ((atom)->a_type = A_SYMBOL, (atom)->a_w.w_symbol = (s))
+#define CLASS_MAINSIGNALIN(c, type, field) class_domainsignalin(c, (char *)(&((type *)0)->field) - (char *)0)
+#ifdef __cplusplus
+extern "C" {
+#endif
+t_symbol *gensym(const char *s);
+t_pd *pd_new(t_class *cls);
+void pd_free(t_pd *x);
+void pd_bind(t_pd *x, t_symbol *s); void pd_unbind(t_pd *x, t_symbol *s);
+t_pd *pd_findbyclass(t_symbol *s, const t_class *c);
+const char *class_getname(const t_class *c);
+t_class *class_new(t_symbol *name, t_newmethod newmethod, t_method freemethod, size_t size, int flags, t_atomtype arg1, ...);
+void class_addmethod(t_class *c, t_method fn, t_symbol *sel, t_atomtype arg1, ...);
+void class_addbang(t_class *c, t_method fn);
+void class_addlist(t_class *c, t_method fn);
+void class_addanything(t_class *c, t_method fn);
+void class_domainsignalin(t_class *c, int onset);
+#define class_addbang(x, y) class_addbang((x), (t_method)(y))
+#define class_addlist(x, y) class_addlist((x), (t_method)(y))
+#define class_addanything(x, y) class_addanything((x), (t_method)(y))
+t_inlet *inlet_new(t_object *owner, t_pd *dest, t_symbol *s1, t_symbol *s2);
+void inlet_free(t_inlet *x);
+t_outlet *outlet_new(t_object *owner, t_symbol *s);
+void outlet_free(t_outlet *x);
+void outlet_bang(t_outlet *x); void outlet_float(t_outlet *x, t_float f);
+void outlet_list(t_outlet *x, t_symbol *s, int argc, t_atom *argv);
+void outlet_anything(t_outlet *x, t_symbol *s, int argc, t_atom *argv);
+t_float atom_getfloat(const t_atom *a); t_symbol *atom_getsymbol(const t_atom *a);
+t_float atom_getfloatarg(int which, int argc, const t_atom *argv);
+void post(const char *fmt, ...); void pd_error(const void *object, const char *fmt, ...);
+t_float sys_getsr(void); int sys_getblksize(void);
+void sys_getversion(int *major, int *minor, int *bugfix);
+void dsp_add(t_perfroutine f, int n, ...);
+void dsp_add_zero(t_sample *vec, int n);
+void signal_setmultiout(t_signal **sig, int nchans);
+int garray_getfloatwords(t_garray *x, int *size, t_word **vec);
+void garray_usedindsp(t_garray *x);
+double clock_getlogicaltime(void); double clock_gettimesince(double prevsystime);
+double clock_gettimesincewithunits(double prevsystime, double units, int sampflag);
+void *getbytes(size_t nbytes); void freebytes(void *x, size_t nbytes);
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,231 @@
+/**
+ * @file m_pd_stub.cpp
+ * @brief implementation of the stub m_pd.h, see pd_stub.h
+ */
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include "m_pd.h"
+#include "pd_stub.h"
+
+struct _class {
+  t_symbol *c_name;
+  size_t c_size;
+  int c_flags;
+};
+
+struct _outlet { int dummy; };
+struct _inlet { int dummy; };
+
+t_symbol s_signal = { "signal", nullptr, nullptr };
+t_symbol s_anything = { "anything", nullptr, nullptr };
+t_symbol s_list = { "list", nullptr, nullptr };
+t_symbol s_float = { "float", nullptr, nullptr };
+t_symbol s_bang = { "bang", nullptr, nullptr };
+t_symbol s_symbol = { "symbol", nullptr, nullptr };
+t_symbol s__X = { "#X", nullptr, nullptr };
+
+static t_class garray_stub_class = { &s_anything, 0, 0 };
+t_class *garray_class = &garray_stub_class;
+
+std::vector<PdStubMessage> pd_stub_messages;
+
+static t_float stub_sr = 48000;
+static int stub_blocksize = 64;
+
+struct StubDspEntry {
+  t_perfroutine fn;
+  std::vector<t_int> args;
+};
+
+static std::vector<StubDspEntry> stub_chain;
+
+//================================= STUB API =================================//
+
+void pd_stub_set_dsp_params(t_float sr, int blockSize) {
+  stub_sr = sr;
+  stub_blocksize = blockSize;
+}
+
+void pd_stub_dsp_clear() {
+  stub_chain.clear();
+}
+
+void pd_stub_dsp_tick() {
+  for (auto& e : stub_chain) {
+    e.fn(e.args.data());
+  }
+}
+
+void *pd_stub_new(t_gimme_new fn, const char *name, const std::vector<t_atom>& args) {
+  return fn(gensym(name), args.size(), const_cast<t_atom *>(args.data()));
+}
+
+t_atom pd_stub_float(t_float f) {
+  t_atom a;
+  SETFLOAT(&a, f);
+  return a;
+}
+
+t_atom pd_stub_symbol(const char *s) {
+  t_atom a;
+  SETSYMBOL(&a, gensym(s));
+  return a;
+}
+
+//================================ PD API ====================================//
+
+t_symbol *gensym(const char *s) {
+  static std::map<std::string, t_symbol *> table;
+  auto& sym = table[s];
+
+  if (sym == nullptr) {
+    sym = new t_symbol{ strdup(s), nullptr, nullptr };
+  }
+
+  return sym;
+}
+
+t_pd *pd_new(t_class *c) {
+  t_pd *x = (t_pd *) calloc(1, c->c_size);
+  *x = c;
+  return x;
+}
+
+void pd_free(t_pd *x) { free(x); }
+
+// only one binding per symbol, which is enough for our needs
+void pd_bind(t_pd *x, t_symbol *s) { s->s_thing = x; }
+void pd_unbind(t_pd *x, t_symbol *s) { if (s->s_thing == x) { s->s_thing = nullptr; } }
+
+t_pd *pd_findbyclass(t_symbol *s, const t_class *c) {
+  return (s->s_thing != nullptr && *s->s_thing == c) ? s->s_thing : nullptr;
+}
+
+const char *class_getname(const t_class *c) { return c->c_name->s_name; }
+
+t_class *class_new(t_symbol *name, t_newmethod, t_method, size_t size, int flags, t_atomtype, ...) {
+  return new t_class{ name, size, flags };
+}
+
+void class_addmethod(t_class *, t_method, t_symbol *, t_atomtype, ...) {}
+void (class_addbang)(t_class *, t_method) {}
+void (class_addlist)(t_class *, t_method) {}
+void (class_addanything)(t_class *, t_method) {}
+void class_domainsignalin(t_class *, int) {}
+
+t_inlet *inlet_new(t_object *, t_pd *, t_symbol *, t_symbol *) { return new t_inlet; }
+void inlet_free(t_inlet *x) { delete x; }
+t_outlet *outlet_new(t_object *, t_symbol *) { return new t_outlet; }
+void outlet_free(t_outlet *x) { delete x; }
+
+static void stub_log(const char *selector, int argc, const t_atom *argv) {
+  PdStubMessage m;
+  m.selector = selector;
+
+  for (int i = 0; i < argc; ++i) {
+    m.values.push_back(atom_getfloat(argv + i));
+  }
+
+  pd_stub_messages.push_back(m);
+}
+
+void outlet_bang(t_outlet *) { stub_log("bang", 0, nullptr); }
+
+void outlet_float(t_outlet *, t_float f) {
+  t_atom a;
+  SETFLOAT(&a, f);
+  stub_log("float", 1, &a);
+}
+
+void outlet_list(t_outlet *, t_symbol *, int argc, t_atom *argv) {
+  stub_log("list", argc, argv);
+}
+
+void outlet_anything(t_outlet *, t_symbol *s, int argc, t_atom *argv) {
+  stub_log(s->s_name, argc, argv);
+}
+
+t_float atom_getfloat(const t_atom *a) {
+  return a->a_type == A_FLOAT ? a->a_w.w_float : 0;
+}
+
+t_symbol *atom_getsymbol(const t_atom *a) {
+  return a->a_type == A_SYMBOL ? a->a_w.w_symbol : &s_symbol;
+}
+
+t_float atom_getfloatarg(int which, int argc, const t_atom *argv) {
+  return which < argc ? atom_getfloat(argv + which) : 0;
+}
+
+void post(const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  vfprintf(stderr, fmt, args);
+  va_end(args);
+  fprintf(stderr, "\n");
+}
+
+void pd_error(const void *, const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  vfprintf(stderr, fmt, args);
+  va_end(args);
+  fprintf(stderr, "\n");
+}
+
+t_float sys_getsr(void) { return stub_sr; }
+int sys_getblksize(void) { return stub_blocksize; }
+
+void sys_getversion(int *major, int *minor, int *bugfix) {
+  *major = PD_MAJOR_VERSION;
+  *minor = PD_MINOR_VERSION;
+  *bugfix = 0;
+}
+
+void dsp_add(t_perfroutine f, int n, ...) {
+  StubDspEntry e;
+  e.fn = f;
+  // the perform routines get a pointer to their own address first
+  e.args.push_back(reinterpret_cast<t_int>(f));
+
+  va_list args;
+  va_start(args, n);
+
+  for (int i = 0; i < n; ++i) {
+    e.args.push_back(va_arg(args, t_int));
+  }
+
+  va_end(args);
+  stub_chain.push_back(e);
+}
+
+void dsp_add_zero(t_sample *vec, int n) {
+  std::fill(vec, vec + n, 0);
+}
+
+// the real one allocates a new signal, we just give it a new buffer
+void signal_setmultiout(t_signal **sig, int nchans) {
+  static std::vector<std::vector<t_sample>> buffers;
+  buffers.emplace_back(nchans * (*sig)->s_n, 0);
+  (*sig)->s_vec = buffers.back().data();
+  (*sig)->s_nchans = nchans;
+}
+
+int garray_getfloatwords(t_garray *, int *size, t_word **vec) {
+  *size = 0;
+  *vec = nullptr;
+  return 0;
+}
+
+void garray_usedindsp(t_garray *) {}
+
+double clock_getlogicaltime(void) { return 0; }
+double clock_gettimesince(double) { return 0; }
+double clock_gettimesincewithunits(double, double, int) { return 0; }
+
+void *getbytes(size_t nbytes) { return calloc(1, nbytes); }
+void freebytes(void *x, size_t) { free(x); }
@@ -0,0 +1,58 @@
+/**
+ * @file pd_stub.h
+ * @brief helpers to drive the externals built against the stub m_pd.h
+ */
+
+#ifndef _JL_PD_STUB_H_
+#define _JL_PD_STUB_H_
+
+#include <string>
+#include <vector>
+#include "m_pd.h"
+
+// one entry per outlet_* call, symbol atoms are logged as 0
+struct PdStubMessage {
+  std::string selector;
+  std::vector<t_float> values;
+};
+
+extern std::vector<PdStubMessage> pd_stub_messages;
+
+// owns the signal vectors given to an object's dsp method
+struct PdStubSignals {
+  std::vector<std::vector<t_sample>> buffers;
+  std::vector<t_signal> signals;
+  std::vector<t_signal*> pointers;
+
+  PdStubSignals(unsigned int nbSignals, int blockSize) :
+  buffers(nbSignals, std::vector<t_sample>(blockSize, 0)),
+  signals(nbSignals),
+  pointers(nbSignals) {
+    for (unsigned int i = 0; i < nbSignals; ++i) {
+      signals[i] = t_signal();
+      signals[i].s_n = blockSize;
+      signals[i].s_vec = buffers[i].data();
+      signals[i].s_sr = 48000;
+      signals[i].s_nchans = 1;
+      pointers[i] = &signals[i];
+    }
+  }
+
+  t_signal** get() { return pointers.data(); }
+  t_sample* vec(unsigned int i) { return signals[i].s_vec; }
+};
+
+// set the values returned by sys_getsr and sys_getblksize
+void pd_stub_set_dsp_params(t_float sr, int blockSize);
+
+// dsp_add appends to a chain that can be cleared and run block by block
+void pd_stub_dsp_clear();
+void pd_stub_dsp_tick();
+
+// create an object from its class and creation arguments
+typedef void *(*t_gimme_new)(t_symbol *s, int argc, t_atom *argv);
+void *pd_stub_new(t_gimme_new fn, const char *name, const std::vector<t_atom>& args);
+t_atom pd_stub_float(t_float f);
+t_atom pd_stub_symbol(const char *s);
+
+#endif /* _JL_PD_STUB_H_ */